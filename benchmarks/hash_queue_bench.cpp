@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+#include "hashqueue.h"
+
+#include <random>
+#include <vector>
+
+using namespace data_structures;
+
+template<std::size_t Arity>
+using ArityQueue = EagerQueue<int, int, std::hash<int>, std::equal_to<int>, Arity>;
+
+static std::vector<double> random_times(std::size_t n, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> distrib(0, 1e6);
+    std::vector<double> times(n);
+    for (auto& t: times) { t = distrib(rng); }
+    return times;
+}
+
+template<std::size_t Arity>
+static void BM_push_pop(benchmark::State& state) {  // fill up, then drain completely
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto times = random_times(n, 42);
+    for (auto _: state) {
+        ArityQueue<Arity> q;
+        for (std::size_t i = 0; i < n; ++i) {
+            q.push(times[i], static_cast<int>(i));
+        }
+        while (q.size()) {
+            benchmark::DoNotOptimize(q.pop());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+template<std::size_t Arity>
+static void BM_reschedule(benchmark::State& state) {  // steady-state timer updates on a full queue
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto times = random_times(n, 42);
+    ArityQueue<Arity> q;
+    for (std::size_t i = 0; i < n; ++i) {
+        q.push(times[i], static_cast<int>(i));
+    }
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> ids(0, static_cast<int>(n) - 1);
+    std::uniform_real_distribution<double> distrib(0, 1e6);
+    for (auto _: state) {
+        q.reschedule(ids(rng), distrib(rng));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+template<std::size_t Arity>
+static void BM_hold(benchmark::State& state) {  // classic hold model: pop the earliest, re-push it later
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto times = random_times(n, 42);
+    ArityQueue<Arity> q;
+    for (std::size_t i = 0; i < n; ++i) {
+        q.push(times[i], static_cast<int>(i));
+    }
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> distrib(0, 1e6);
+    for (auto _: state) {
+        auto [time, id] = q.pop();
+        q.push(time + distrib(rng), id);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+#define ARITY_BENCHMARKS(BM) \
+    BENCHMARK_TEMPLATE(BM, 2)->RangeMultiplier(10)->Range(1000, 1000000); \
+    BENCHMARK_TEMPLATE(BM, 4)->RangeMultiplier(10)->Range(1000, 1000000); \
+    BENCHMARK_TEMPLATE(BM, 8)->RangeMultiplier(10)->Range(1000, 1000000)
+
+ARITY_BENCHMARKS(BM_push_pop);
+ARITY_BENCHMARKS(BM_reschedule);
+ARITY_BENCHMARKS(BM_hold);
@@ -0,0 +1,197 @@
+#include <benchmark/benchmark.h>
+#include "hashqueue.h"
+#include "adaptivequeue.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace data_structures;
+
+namespace {
+    // the baseline one writes without an addressable queue: a std::priority_queue with lazy deletion,
+    // where the map holds each live ID's current time and heap entries that disagree with it are stale
+    class StdQueue {
+    private:
+        using entry = std::pair<double, int>;
+        std::priority_queue<entry, std::vector<entry>, std::greater<entry>> _heap;
+        std::unordered_map<int, double> _live;
+    public:
+        void push(double time, int id) {
+            _live[id] = time;
+            _heap.emplace(time, id);
+        }
+        std::pair<double, int> pop() {
+            for (;;) {
+                const entry top = _heap.top();
+                _heap.pop();
+                auto it = _live.find(top.second);
+                if (it != _live.end() && it->second == top.first) {
+                    _live.erase(it);
+                    return top;
+                }
+            }
+        }
+        void remove(int id) { _live.erase(id); }
+        void reschedule(int id, double time) { push(time, id); }
+        [[nodiscard]] std::size_t size() const { return _live.size(); }
+    };
+
+    using Eager = EagerQueue<int, int>;
+    using Eager4 = EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4>;
+    using Lazy = LazyQueue<int, int>;
+    using Pairing = PairingQueue<int, int>;
+    using Adaptive = AdaptiveQueue<int, int>;
+
+    // a random digraph of n nodes and degree out-edges each, as adjacency lists of (target, weight)
+    std::vector<std::vector<std::pair<int, double>>> random_graph(std::size_t n, std::size_t degree) {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<int> nodes(0, static_cast<int>(n) - 1);
+        std::uniform_real_distribution<double> weights(1, 100);
+        std::vector<std::vector<std::pair<int, double>>> graph(n);
+        for (auto& edges: graph) {
+            for (std::size_t e = 0; e < degree; ++e) { edges.emplace_back(nodes(rng), weights(rng)); }
+        }
+        return graph;
+    }
+
+    template<typename Queue>
+    void fill(Queue& q, std::size_t n, std::mt19937& rng) {
+        std::uniform_real_distribution<double> distrib(0, 1e6);
+        for (std::size_t i = 0; i < n; ++i) {
+            q.push(distrib(rng), static_cast<int>(i));
+        }
+    }
+}
+
+template<typename Queue>
+static void BM_fill_drain(benchmark::State& state) {  // n pushes, then n pops
+    const auto n = static_cast<std::size_t>(state.range(0));
+    for (auto _: state) {
+        std::mt19937 rng(42);
+        Queue q;
+        fill(q, n, rng);
+        while (q.size()) {
+            benchmark::DoNotOptimize(q.pop());
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+// steady state on a queue of n IDs; every operation leaves the same IDs queued:
+// reschedule% of them move an ID, remove% remove one and push it back, and the rest pop the earliest
+// and push it back later (the hold model)
+template<typename Queue>
+static void BM_mix(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto reschedule_pct = static_cast<unsigned>(state.range(1));
+    const auto remove_pct = static_cast<unsigned>(state.range(2));
+    std::mt19937 rng(42);
+    Queue q;
+    fill(q, n, rng);
+    std::uniform_int_distribution<int> ids(0, static_cast<int>(n) - 1);
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    std::uniform_real_distribution<double> delay(0, 1e6);
+    double now = 0;
+    for (auto _: state) {
+        const unsigned op = percent(rng);
+        if (op < reschedule_pct) {
+            q.reschedule(ids(rng), now + delay(rng));
+        } else if (op < reschedule_pct + remove_pct) {
+            const int id = ids(rng);
+            q.remove(id);
+            q.push(now + delay(rng), id);
+        } else {
+            auto [time, id] = q.pop();
+            now = time;
+            q.push(now + delay(rng), id);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// {n, reschedule%, remove%}
+static void mixes(benchmark::internal::Benchmark* b) {
+    for (int64_t n = 1000; n <= 10000000; n *= 10) {
+        b->Args({n, 0, 0});
+        b->Args({n, 50, 0});
+        b->Args({n, 0, 50});
+        b->Args({n, 25, 25});
+    }
+}
+
+// Dijkstra from node 0 over {n nodes, out-degree}; every improvement of a queued distance is a reschedule
+// (decrease-key), and denser graphs make more of them per pop
+template<typename Queue>
+static void BM_dijkstra(benchmark::State& state) {
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto graph = random_graph(n, static_cast<std::size_t>(state.range(1)));
+    std::vector<double> dist(n);
+    std::vector<char> done(n);
+    for (auto _: state) {
+        std::fill(dist.begin(), dist.end(), std::numeric_limits<double>::infinity());
+        std::fill(done.begin(), done.end(), 0);
+        Queue q;
+        dist[0] = 0;
+        q.push(0, 0);
+        while (q.size()) {
+            auto [d, u] = q.pop();
+            done[u] = 1;
+            for (auto [v, w]: graph[u]) {
+                if (done[v] || d + w >= dist[v]) { continue; }
+                if (dist[v] == std::numeric_limits<double>::infinity()) {
+                    q.push(d + w, v);
+                } else {
+                    q.reschedule(v, d + w);
+                }
+                dist[v] = d + w;
+            }
+        }
+        benchmark::DoNotOptimize(dist.data());
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+#define QUEUE_BENCHMARKS(Q) \
+    BENCHMARK_TEMPLATE(BM_fill_drain, Q)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond); \
+    BENCHMARK_TEMPLATE(BM_mix, Q)->Apply(mixes)
+
+QUEUE_BENCHMARKS(Eager);
+QUEUE_BENCHMARKS(Eager4);
+QUEUE_BENCHMARKS(Lazy);
+QUEUE_BENCHMARKS(Pairing);
+QUEUE_BENCHMARKS(Adaptive);
+QUEUE_BENCHMARKS(StdQueue);
+
+// the k highest of a stream of random scores: a bounded queue against pushing and then popping the surplus
+template<bool Bounded>
+static void BM_top_k(benchmark::State& state) {
+    const auto k = static_cast<std::size_t>(state.range(0));
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> scores(0, 1e6);
+    Eager q = Bounded ? Eager{Capacity{k}} : Eager{};
+    int id = 0;
+    for (auto _: state) {
+        if constexpr (Bounded) {
+            q.push(scores(rng), id++);
+        } else {
+            q.push(scores(rng), id++);
+            if (q.size() > k) { q.pop(); }
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+BENCHMARK_TEMPLATE(BM_top_k, true)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_top_k, false)->RangeMultiplier(10)->Range(10, 100000);
+
+#define DIJKSTRA_BENCHMARK(Q) \
+    BENCHMARK_TEMPLATE(BM_dijkstra, Q)->ArgsProduct({{1000, 100000, 1000000}, {8, 64}})->Unit(benchmark::kMillisecond)
+
+DIJKSTRA_BENCHMARK(Eager);
+DIJKSTRA_BENCHMARK(Eager4);
+DIJKSTRA_BENCHMARK(Pairing);
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include "randomdict.h"
+#include "concurrentrandomdict.h"
+
+#include <iterator>
+#include <memory>
+#include <random>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace data_structures;
+
+namespace {
+    // the baseline: std::unordered_map, sampled by picking buckets until a non-empty one turns up and then
+    // an entry within it; cheap, but only close to uniform while the buckets are evenly filled
+    class StdDict {
+    private:
+        std::unordered_map<int, int> _m;
+        mutable std::mt19937 _rng;
+    public:
+        explicit StdDict(unsigned seed): _rng(seed) {}
+        int insert(int key, int val) { return _m.emplace(key, val).second ? 1 : 0; }
+        int erase(int key) { return static_cast<int>(_m.erase(key)); }
+        [[nodiscard]] std::size_t size() const { return _m.size(); }
+        std::pair<int, int> random_pair() const {
+            std::uniform_int_distribution<std::size_t> buckets(0, _m.bucket_count() - 1);
+            for (;;) {
+                const std::size_t b = buckets(_rng);
+                if (const std::size_t n = _m.bucket_size(b)) {
+                    auto it = _m.begin(b);
+                    std::advance(it, std::uniform_int_distribution<std::size_t>(0, n - 1)(_rng));
+                    return *it;
+                }
+            }
+        }
+    };
+
+    // one spelling of insert and of a random draw for every container
+    template<typename C>
+    struct Ops {  // the dictionaries and StdDict
+        static C make() { return C(42); }
+        static void insert(C& c, int key) { c.insert(key, key); }
+        static auto random(const C& c) { return c.random_pair(); }
+    };
+    template<typename... Args>
+    struct Ops<RandomSet<int, Args...>> {
+        static RandomSet<int, Args...> make() { return RandomSet<int, Args...>(42); }
+        static void insert(RandomSet<int, Args...>& c, int key) { c.insert(key); }
+        static auto random(const RandomSet<int, Args...>& c) { return c.random_elem(); }
+    };
+    template<typename... Args>
+    struct Ops<FlatRandomSet<int, Args...>> {
+        static FlatRandomSet<int, Args...> make() { return FlatRandomSet<int, Args...>(42); }
+        static void insert(FlatRandomSet<int, Args...>& c, int key) { c.insert(key); }
+        static auto random(const FlatRandomSet<int, Args...>& c) { return c.random_elem(); }
+    };
+    template<typename... Args>
+    struct Ops<WeightedRandomDict<int, int, Args...>> {
+        static WeightedRandomDict<int, int, Args...> make() { return WeightedRandomDict<int, int, Args...>(42); }
+        static void insert(WeightedRandomDict<int, int, Args...>& c, int key) { c.insert(key, key, 1.0 + key % 7); }
+        static auto random(const WeightedRandomDict<int, int, Args...>& c) { return c.random_pair(); }
+    };
+    template<typename... Args>
+    struct Ops<ConcurrentRandomSet<int, Args...>> {
+        // default constructed; neither copyable nor movable, hence the unique_ptr in filled
+        static void insert(ConcurrentRandomSet<int, Args...>& c, int key) { c.insert(key); }
+        static auto random(const ConcurrentRandomSet<int, Args...>& c) { return c.random_elem(); }
+    };
+
+    using IntSet = RandomSet<int>;
+    using IntDict = RandomDict<int, int>;
+    using IntWeighted = WeightedRandomDict<int, int>;
+    using IntFlatSet = FlatRandomSet<int>;
+    using IntFlatDict = FlatRandomDict<int, int>;
+    using IntConcurrentSet = ConcurrentRandomSet<int>;
+
+    template<typename C>
+    std::unique_ptr<C> filled(std::size_t n) {
+        std::unique_ptr<C> c;
+        if constexpr (std::is_default_constructible_v<C>) {
+            c = std::make_unique<C>();
+        } else {
+            c = std::make_unique<C>(Ops<C>::make());
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            Ops<C>::insert(*c, static_cast<int>(i));
+        }
+        return c;
+    }
+}
+
+template<typename C>
+static void BM_insert(benchmark::State& state) {  // n fresh keys into an empty container
+    const auto n = static_cast<std::size_t>(state.range(0));
+    for (auto _: state) {
+        benchmark::DoNotOptimize(filled<C>(n));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * n));
+}
+
+template<typename C>
+static void BM_churn(benchmark::State& state) {  // steady state of n keys: erase a random one, insert a new one
+    const auto n = static_cast<std::size_t>(state.range(0));
+    auto c = filled<C>(n);
+    std::vector<int> keys(n);
+    for (std::size_t i = 0; i < n; ++i) { keys[i] = static_cast<int>(i); }
+    int next = static_cast<int>(n);
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<std::size_t> slots(0, n - 1);
+    for (auto _: state) {
+        int& key = keys[slots(rng)];
+        c->erase(key);
+        key = next++;
+        Ops<C>::insert(*c, key);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * 2));
+}
+
+template<typename C>
+static void BM_sample(benchmark::State& state) {  // one uniformly random element per iteration
+    const auto n = static_cast<std::size_t>(state.range(0));
+    const auto c = filled<C>(n);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(Ops<C>::random(*c));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+#define CONTAINER_BENCHMARKS(C) \
+    BENCHMARK_TEMPLATE(BM_insert, C)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond); \
+    BENCHMARK_TEMPLATE(BM_churn, C)->RangeMultiplier(10)->Range(1000, 1000000); \
+    BENCHMARK_TEMPLATE(BM_sample, C)->RangeMultiplier(10)->Range(1000, 1000000)
+
+CONTAINER_BENCHMARKS(IntSet);
+CONTAINER_BENCHMARKS(IntFlatSet);
+CONTAINER_BENCHMARKS(IntConcurrentSet);
+CONTAINER_BENCHMARKS(IntDict);
+CONTAINER_BENCHMARKS(IntFlatDict);
+CONTAINER_BENCHMARKS(IntWeighted);
+CONTAINER_BENCHMARKS(StdDict);
@@ -0,0 +1,190 @@
+#ifndef GSK_ADAPTIVEQUEUE_H
+#define GSK_ADAPTIVEQUEUE_H
+
+#include "hashqueue.h"
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <cstddef>
+
+namespace data_structures {
+    enum class QueueMode { lazy, eager };
+
+    // when an AdaptiveQueue changes representation; the gap between to_eager and to_lazy keeps a mix near
+    // either threshold from flipping it back and forth
+    struct AdaptivePolicy {
+        double to_eager{0.5};  // lazy -> eager once removes and reschedules exceed this share of the operations
+        double to_lazy{0.2};  // eager -> lazy once they fall below it
+        double max_tombstones{0.4};  // lazy -> eager once dead entries exceed this share of the heap, whatever the mix
+        std::size_t min_window{4096};  // operations per decision at least; a decision also waits for size() of them
+    };
+
+    // a timer queue with the combined API of EagerQueue and LazyQueue that is either of them at any time:
+    // a LazyQueue while the operations are mostly pushes and pops, an EagerQueue once removes and reschedules,
+    // which leave tombstones behind in a LazyQueue, take over the mix
+    // the operations are tallied in windows of max(min_window, size()), at the end of which AdaptivePolicy decides;
+    // a switch moves every entry across and rebuilds the heap in O(n), which the window amortises to O(1) each
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            std::size_t Arity=2, typename Priority=double, typename Compare=std::less<Priority>,
+            typename IdOf=DynamicIdOf<T, ID>, typename Index=NodeIndex>
+    class AdaptiveQueue {
+    public:
+        using lazy_type = LazyQueue<T, ID, Hash, KeyEqual, Priority, Compare, IdOf, Index>;
+        using eager_type = EagerQueue<T, ID, Hash, KeyEqual, Arity, Priority, Compare, IdOf, Index>;
+        using priority_type = Priority;
+        using size_type = std::size_t;
+    private:
+        lazy_type _lazy;
+        eager_type _eager;  // the one not in use is empty
+        QueueMode _mode{QueueMode::lazy};
+        AdaptivePolicy _policy;
+        // the current window
+        size_type _ops{};
+        size_type _updates{};  // removes and reschedules
+        size_type _switches{};
+    private:
+        void tally(size_type ops, size_type updates) {
+            _ops += ops;
+            _updates += updates;
+            if (_ops >= std::max(_policy.min_window, size())) { decide(); }
+        }
+        void decide() {
+            const double updates = static_cast<double>(_updates) / static_cast<double>(_ops);
+            if (_mode == QueueMode::lazy) {
+                const double heap = static_cast<double>(_lazy.size() + _lazy.tombstones());
+                if (updates > _policy.to_eager
+                    || static_cast<double>(_lazy.tombstones()) > _policy.max_tombstones * heap) {
+                    switch_to(QueueMode::eager);
+                }
+            } else if (updates < _policy.to_lazy) {
+                switch_to(QueueMode::lazy);
+            }
+            _ops = _updates = 0;
+        }
+        template<typename From, typename To>
+        static void migrate(From& from, To& to) {
+            std::vector<std::pair<Priority, T>> entries;
+            entries.reserve(from.size());
+            from.extract_all(std::back_inserter(entries));
+            to.push_range(std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+        }
+    public:
+        AdaptiveQueue() = default;
+        explicit AdaptiveQueue(AdaptivePolicy policy): _policy{policy} {}
+        template<typename F, std::enable_if_t<!std::is_convertible_v<F, AdaptivePolicy>, bool> = true>
+        explicit AdaptiveQueue(F f, AdaptivePolicy policy = {}): _lazy{f}, _eager{std::move(f)}, _policy{policy} {}
+
+        // whichever representation holds the entries now
+        [[nodiscard]] QueueMode mode() const noexcept { return _mode; }
+        [[nodiscard]] size_type switches() const noexcept { return _switches; }
+        [[nodiscard]] const AdaptivePolicy& policy() const noexcept { return _policy; }
+        void set_policy(AdaptivePolicy policy) noexcept { _policy = policy; }
+
+        // moves every entry into the other representation now, in O(n); a no-op if it is in use already
+        // the payloads are moved twice, through a buffer, and if one throws on the way the entries not moved are lost
+        void switch_to(QueueMode mode) {
+            if (mode == _mode) { return; }
+            if (mode == QueueMode::eager) {
+                migrate(_lazy, _eager);
+            } else {
+                migrate(_eager, _lazy);
+            }
+            _mode = mode;
+            ++_switches;
+        }
+
+        template<typename ...Arg>
+        void push(Priority time, Arg&&... args) {
+            if (_mode == QueueMode::eager) {
+                _eager.push(std::move(time), std::forward<Arg>(args)...);
+            } else {
+                _lazy.push(std::move(time), std::forward<Arg>(args)...);
+            }
+            tally(1, 0);
+        }
+
+        // inserts every (time, payload) pair in [first, last); see EagerQueue::push_range
+        template<typename It>
+        void push_range(It first, It last) {
+            const size_type old_size = size();
+            if (_mode == QueueMode::eager) {
+                _eager.push_range(first, last);
+            } else {
+                _lazy.push_range(first, last);
+            }
+            tally(size() - old_size, 0);
+        }
+
+        std::pair<Priority, T> pop() {
+            auto result = _mode == QueueMode::eager ? _eager.pop() : _lazy.pop();
+            tally(1, 0);
+            return result;
+        }
+
+        // pops every entry due by time (i.e. not after it) in priority order into sink; see EagerQueue::pop_until
+        template<typename Sink>
+        size_type pop_until(const Priority& time, Sink sink) {
+            const size_type k = _mode == QueueMode::eager ? _eager.pop_until(time, std::move(sink))
+                                                          : _lazy.pop_until(time, std::move(sink));
+            tally(k, 0);
+            return k;
+        }
+
+        // pops the first (at most) n entries in priority order into sink; see EagerQueue::pop_until
+        template<typename Sink>
+        size_type pop_n(size_type n, Sink sink) {
+            const size_type k = _mode == QueueMode::eager ? _eager.pop_n(n, std::move(sink))
+                                                          : _lazy.pop_n(n, std::move(sink));
+            tally(k, 0);
+            return k;
+        }
+
+        // not const: a LazyQueue drops the tombstones it finds on top
+        std::pair<Priority, const T&> peek() {
+            return _mode == QueueMode::eager ? _eager.peek() : _lazy.peek();
+        }
+
+        void remove(const ID& id) {
+            if (_mode == QueueMode::eager) {
+                _eager.remove(id);
+            } else {
+                _lazy.remove(id);
+            }
+            tally(1, 1);
+        }
+
+        void reschedule(const ID& id, Priority new_time) {
+            if (_mode == QueueMode::eager) {
+                _eager.reschedule(id, std::move(new_time));
+            } else {
+                _lazy.reschedule(id, std::move(new_time));
+            }
+            tally(1, 1);
+        }
+
+        [[nodiscard]] bool contains(const ID& id) const {
+            return _mode == QueueMode::eager ? _eager.contains(id) : _lazy.contains(id);
+        }
+
+        void reserve(size_type n) {
+            if (_mode == QueueMode::eager) {
+                _eager.reserve(n);
+            } else {
+                _lazy.reserve(n);
+            }
+        }
+
+        void clear() noexcept {
+            _eager.clear();
+            _lazy.clear();
+        }
+
+        [[nodiscard]] size_type size() const noexcept {
+            return _mode == QueueMode::eager ? _eager.size() : _lazy.size();
+        }
+    };
+}
+
+#endif //GSK_ADAPTIVEQUEUE_H
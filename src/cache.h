@@ -0,0 +1,192 @@
+#ifndef GSK_CACHE_H
+#define GSK_CACHE_H
+
+#include "hashqueue.h"
+#include "randomdict.h"
+
+#include <utility>
+#include <optional>
+#include <functional>
+#include <random>
+#include <cassert>
+#include <stdexcept>
+#include <cstddef>
+
+namespace data_structures::detail {
+    // the ID of a TtlCache entry: a pointer to the key inside the queued payload, which stays put
+    // (entries live in an EntryPool), so the index holds no second copy of any key
+    template<typename K>
+    struct KeyRef {
+        const K* key{nullptr};
+    };
+
+    template<typename K, typename V>
+    struct KeyRefOf {
+        KeyRef<K> operator()(const std::pair<K, V>& payload) const noexcept { return {&payload.first}; }
+    };
+
+    // Hash and KeyEqual lifted to KeyRef, and made transparent so that the index is searched by plain keys
+    template<typename K, typename Hash>
+    struct KeyRefHash: private Hash {
+        using is_transparent = void;
+        std::size_t operator()(KeyRef<K> ref) const { return Hash::operator()(*ref.key); }
+        std::size_t operator()(const K& key) const { return Hash::operator()(key); }
+    };
+
+    template<typename K, typename KeyEqual>
+    struct KeyRefEqual: private KeyEqual {
+        using is_transparent = void;
+        bool operator()(KeyRef<K> lhs, KeyRef<K> rhs) const { return KeyEqual::operator()(*lhs.key, *rhs.key); }
+        bool operator()(KeyRef<K> lhs, const K& rhs) const { return KeyEqual::operator()(*lhs.key, rhs); }
+        bool operator()(const K& lhs, KeyRef<K> rhs) const { return KeyEqual::operator()(lhs, *rhs.key); }
+    };
+}
+
+namespace data_structures {
+    // a cache of at most capacity entries that makes room by evicting a uniformly random one, in O(1):
+    // a RandomDict underneath, so each key is stored and hashed once and a victim is a single draw
+    template<typename K, typename V,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937,
+            typename Allocator=std::allocator<std::pair<const K, V>>>
+    class RandomEvictionCache {
+    public:
+        using dict_type = RandomDict<K, V, Hash, KeyEqual, Engine, Allocator>;
+        using size_type = std::size_t;
+    private:
+        dict_type _dict;
+        size_type _capacity;
+    public:
+        RandomEvictionCache(size_type capacity, typename Engine::result_type seed): _dict(seed), _capacity{capacity} {
+            assert(capacity > 0);
+            _dict.reserve(capacity + 1);  // a new key is in before the victim is out
+        }
+        RandomEvictionCache(size_type capacity, typename Engine::result_type seed, const Allocator& alloc):
+            _dict(seed, alloc), _capacity{capacity} {
+            assert(capacity > 0);
+            _dict.reserve(capacity + 1);  // a new key is in before the victim is out
+        }
+
+        [[nodiscard]] size_type size() const noexcept { return _dict.size(); }
+        [[nodiscard]] size_type capacity() const noexcept { return _capacity; }
+        [[nodiscard]] bool contains(const K& key) const { return _dict.count(key) != 0; }
+        const dict_type& dict() const noexcept { return _dict; }
+        void clear() noexcept { _dict.clear(); }
+
+        // throws std::out_of_range if key is not cached
+        V& at(const K& key) { return _dict.at(key); }
+        const V& at(const K& key) const { return _dict.at(key); }
+
+        // caches val under key, overwriting any value there; a new key arriving at a full cache
+        // evicts a random other entry, which is handed back; key is looked up once either way
+        template<typename KT, typename VT>
+        std::optional<std::pair<K, V>> put(KT&& key, VT&& val) {
+            auto [it, inserted] = _dict.try_emplace(std::forward<KT>(key), std::forward<VT>(val));
+            if (!inserted) {
+                it->second = std::forward<VT>(val);  // untouched by try_emplace
+                return std::nullopt;
+            }
+            if (_dict.size() <= _capacity) { return std::nullopt; }
+            return _dict.pop_random_except(it);
+        }
+
+        int erase(const K& key) { return _dict.erase(key); }
+
+        // shrinking evicts random entries until the cache fits
+        void set_capacity(size_type capacity) {
+            assert(capacity > 0);
+            _capacity = capacity;
+            while (_dict.size() > _capacity) { _dict.pop_random(); }
+        }
+    };
+
+    // a cache whose entries expire at a time given with each put: the entries sit in an EagerQueue ordered by
+    // expiry, whose index refers back to the key inside each entry, so there is one key and one hash table in all
+    // Time is whatever clock the caller counts in; an entry with expiry t is expired from now == t on
+    // expired entries linger, though never returned, until expire drains them in one batch
+    template<typename K, typename V,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Time=double,
+            std::size_t Arity=4,
+            typename Allocator=std::allocator<std::pair<K, V>>>
+    class TtlCache {
+    public:
+        using queue_type = EagerQueue<std::pair<K, V>, detail::KeyRef<K>, detail::KeyRefHash<K, Hash>,
+                detail::KeyRefEqual<K, KeyEqual>, Arity, Time, std::less<Time>, detail::KeyRefOf<K, V>, FlatIndex,
+                Allocator>;
+        using size_type = std::size_t;
+    private:
+        queue_type _queue;
+    public:
+        TtlCache() = default;
+        // the entries, the heap and the index all allocate from alloc
+        explicit TtlCache(const Allocator& alloc): _queue(alloc) {}
+
+        // expired entries not yet drained included
+        [[nodiscard]] size_type size() const noexcept { return _queue.size(); }
+        void reserve(size_type n) { _queue.reserve(n); }
+        const queue_type& queue() const noexcept { return _queue; }
+
+        [[nodiscard]] bool contains(const K& key, Time now) const { return find(key, now) != nullptr; }
+
+        // the value cached under key unless it has expired by now, otherwise nullptr
+        // one lookup, like put on a cached key
+        V* find(const K& key, Time now) {
+            auto* entry = _queue.find(key);
+            return entry && now < entry->time ? &entry->payload.second : nullptr;
+        }
+        const V* find(const K& key, Time now) const {
+            const auto* entry = _queue.find(key);
+            return entry && now < entry->time ? &entry->payload.second : nullptr;
+        }
+
+        // caches val under key until expiry, replacing the value and the expiry of an existing entry
+        void put(K key, V val, Time expiry) {
+            if (auto* entry = _queue.find(key)) {
+                entry->payload.second = std::move(val);
+                _queue.reschedule(entry, std::move(expiry));
+            } else {
+                _queue.push(std::move(expiry), std::move(key), std::move(val));
+            }
+        }
+
+        // moves the expiry of a cached key, expired or not; false if the key is not cached
+        bool refresh(const K& key, Time expiry) {
+            auto* entry = _queue.find(key);
+            if (!entry) { return false; }
+            _queue.reschedule(entry, std::move(expiry));
+            return true;
+        }
+
+        int erase(const K& key) {
+            auto* entry = _queue.find(key);
+            if (!entry) { return 0; }
+            _queue.remove(entry);
+            return 1;
+        }
+
+        void clear() noexcept { _queue.clear(); }
+
+        // the earliest expiry among the entries; throws std::runtime_error if there is none
+        Time next_expiry() const {
+            if (!_queue.size()) { throw std::runtime_error("empty cache"); }
+            return _queue.peek().first;
+        }
+
+        // drops every entry expired by now, through the batched EagerQueue::pop_until; returns how many
+        size_type expire(Time now) {
+            return _queue.pop_until(now, [](Time, std::pair<K, V>&&) {});
+        }
+        // the same, calling f(key, value) on each expired entry in expiry order
+        template<typename F>
+        size_type expire(Time now, F f) {
+            return _queue.pop_until(now, [&f](Time, std::pair<K, V>&& entry) {
+                f(std::move(entry.first), std::move(entry.second));
+            });
+        }
+    };
+}
+
+#endif //GSK_CACHE_H
@@ -0,0 +1,326 @@
+#ifndef GSK_CONCURRENTRANDOMDICT_H
+#define GSK_CONCURRENTRANDOMDICT_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#include "flatmap.h"
+#include "randomengine.h"
+
+namespace data_structures::detail {
+    // a per-thread engine, seeded differently on every thread
+    template<typename Engine>
+    Engine& thread_engine() {
+        static std::atomic<std::uint64_t> threads{0};
+        thread_local Engine rng(static_cast<typename Engine::result_type>(
+                SplitMix64{std::random_device{}() ^ (threads.fetch_add(1) << 32U)}()));
+        return rng;
+    }
+
+    // an array of trivially copyable values that readers on any thread may sample while one writer changes it
+    // chunk c holds 2^(c + min_bits) elements and is neither moved nor freed before the array is,
+    // so readers reach elements without a lock; a seqlock around each read catches the ones torn by a write
+    // elements are kept as relaxed atomic words, which makes those torn reads well-defined
+    template<typename T>
+    class SeqlockArray {
+        static_assert(std::is_trivially_copyable_v<T>, "elements are copied word by word while being written");
+    public:
+        using size_type = std::size_t;
+    private:
+        using word_type = std::uint64_t;
+        static constexpr size_type words = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+        static constexpr unsigned min_bits = 6;
+        static constexpr unsigned max_chunks = 64 - min_bits;
+
+        std::array<std::atomic<std::atomic<word_type>*>, max_chunks> _chunks{};
+        std::atomic<size_type> _size{0};
+        std::atomic<std::uint64_t> _seq{0};  // odd while a write is in progress
+        size_type _capacity{0};  // writer only
+
+        static unsigned floor_log2(std::uint64_t x) {
+            unsigned r = 0;
+            while (x >>= 1U) { ++r; }
+            return r;
+        }
+        static std::pair<unsigned, size_type> locate(size_type i) {
+            const std::uint64_t j = static_cast<std::uint64_t>(i) + (std::uint64_t{1} << min_bits);
+            const unsigned c = floor_log2(j) - min_bits;
+            return {c, static_cast<size_type>(j - (std::uint64_t{1} << (c + min_bits)))};
+        }
+        [[nodiscard]] std::atomic<word_type>* slot(size_type i) const {
+            const auto [c, offset] = locate(i);
+            std::atomic<word_type>* chunk = _chunks[c].load(std::memory_order_acquire);
+            return chunk ? chunk + offset * words : nullptr;
+        }
+        static void store(std::atomic<word_type>* dst, const T& value) {
+            word_type buffer[words]{};
+            std::memcpy(buffer, &value, sizeof(T));
+            for (size_type w = 0; w < words; ++w) { dst[w].store(buffer[w], std::memory_order_relaxed); }
+        }
+        static T load(const std::atomic<word_type>* src) {
+            word_type buffer[words];
+            for (size_type w = 0; w < words; ++w) { buffer[w] = src[w].load(std::memory_order_relaxed); }
+            union Raw {
+                char none;
+                T value;
+                Raw(): none{} {}
+            } raw;
+            std::memcpy(&raw.value, buffer, sizeof(T));
+            return raw.value;
+        }
+
+        void begin_write() {
+            _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+        void end_write() { _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+    public:
+        SeqlockArray() = default;
+        SeqlockArray(const SeqlockArray&) = delete;
+        SeqlockArray& operator=(const SeqlockArray&) = delete;
+        ~SeqlockArray() {
+            for (auto& chunk: _chunks) { delete[] chunk.load(std::memory_order_relaxed); }
+        }
+
+        // safe on any thread
+        [[nodiscard]] size_type size() const noexcept { return _size.load(std::memory_order_acquire); }
+
+        // a uniformly random element, or nullopt when empty; safe on any thread
+        template<typename Rng>
+        std::optional<T> random(Rng& rng) const {
+            for (;;) {
+                const std::uint64_t seq = _seq.load(std::memory_order_acquire);
+                if (seq & 1U) { continue; }  // a write is in progress
+                const size_type n = _size.load(std::memory_order_acquire);
+                std::optional<T> result;
+                if (n) {
+                    const std::atomic<word_type>* src = slot(static_cast<size_type>(bounded(rng, n)));
+                    if (src) { result = load(src); }
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == seq) { return result; }
+            }
+        }
+
+        // the rest is for the writer alone
+        [[nodiscard]] T get(size_type i) const { return load(slot(i)); }
+
+        void set(size_type i, const T& value) {
+            begin_write();
+            store(slot(i), value);
+            end_write();
+        }
+
+        void push_back(const T& value) {
+            const size_type n = _size.load(std::memory_order_relaxed);
+            if (n == _capacity) {  // published before any reader can see an index in it
+                const unsigned c = locate(n).first;
+                const size_type chunk_size = size_type{1} << (c + min_bits);
+                _chunks[c].store(new std::atomic<word_type>[chunk_size * words], std::memory_order_release);
+                _capacity += chunk_size;
+            }
+            begin_write();
+            store(slot(n), value);
+            _size.store(n + 1, std::memory_order_release);
+            end_write();
+        }
+
+        // moves the last element into i and drops the last slot
+        void erase_swap(size_type i) {
+            const size_type last = _size.load(std::memory_order_relaxed) - 1;
+            begin_write();
+            if (i != last) { store(slot(i), load(slot(last))); }
+            _size.store(last, std::memory_order_release);
+            end_write();
+        }
+
+        void pop_back() { erase_swap(_size.load(std::memory_order_relaxed) - 1); }
+
+        void clear() {
+            begin_write();
+            _size.store(0, std::memory_order_release);
+            end_write();
+        }
+    };
+}
+
+namespace data_structures {
+    // RandomSet for many sampling threads and few writing ones
+    // random_elem, sample and size take no lock and write no shared memory: each thread samples with its own engine,
+    // and a seqlock over the dense array detects the rare read that overlapped a write
+    // insert, erase, count and clear serialize on a mutex; keys must be trivially copyable and are returned by value
+    template<typename K,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=Xoshiro256PlusPlus>
+    class ConcurrentRandomSet {
+    private:
+        detail::SeqlockArray<K> v;
+        using size_type = typename detail::SeqlockArray<K>::size_type;
+        detail::DenseIndex<Hash, KeyEqual> index;  // guarded by writer
+        mutable std::mutex writer;
+    private:
+        auto key_at() const { return [this](size_type idx) { return v.get(idx); }; }
+    public:
+        ConcurrentRandomSet() = default;
+        ConcurrentRandomSet(const ConcurrentRandomSet&) = delete;
+        ConcurrentRandomSet& operator=(const ConcurrentRandomSet&) = delete;
+
+        [[nodiscard]] size_type size() const noexcept { return v.size(); }
+        int count(const K& key) const {
+            std::lock_guard<std::mutex> lock(writer);
+            return index.find(key, key_at()) == index.npos ? 0 : 1;
+        }
+        void clear() {
+            std::lock_guard<std::mutex> lock(writer);
+            v.clear();
+            index.clear();
+        }
+
+        int insert(const K& key) {
+            std::lock_guard<std::mutex> lock(writer);
+            if (index.find(key, key_at()) != index.npos) { return 0; }  // value already exists -> no-op
+            v.push_back(key);
+            try {
+                index.push_back(key_at());
+            } catch (...) {
+                v.pop_back();
+                throw;
+            }
+            return 1;
+        }
+
+        int erase(const K& key) {
+            std::lock_guard<std::mutex> lock(writer);
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { return 0; }  // no-op if not found
+            v.erase_swap(index.remove(slot));
+            return 1;
+        }
+
+        K random_elem() const {
+            std::optional<K> key = v.random(detail::thread_engine<Engine>());
+            if (!key) { throw std::runtime_error("empty set"); }
+            return *key;
+        }
+
+        // writes k keys drawn with replacement to out; each is read separately, so a concurrent
+        // writer may change the set between them
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            auto& rng = detail::thread_engine<Engine>();
+            for (size_type i = 0; i < k; ++i) {
+                std::optional<K> key = v.random(rng);
+                if (!key) { throw std::runtime_error("empty set"); }
+                *out = *key;
+                ++out;
+            }
+            return out;
+        }
+    };
+
+    // RandomDict counterpart of ConcurrentRandomSet; both keys and values must be trivially copyable
+    template<typename K, typename V,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=Xoshiro256PlusPlus>
+    class ConcurrentRandomDict {
+    private:
+        struct Entry {
+            K key;
+            V val;
+        };
+        detail::SeqlockArray<Entry> v;
+        using size_type = typename detail::SeqlockArray<Entry>::size_type;
+        detail::DenseIndex<Hash, KeyEqual> index;  // guarded by writer
+        mutable std::mutex writer;
+    private:
+        auto key_at() const { return [this](size_type idx) { return v.get(idx).key; }; }
+        void append(const K& key, const V& val) {  // the key must be absent
+            v.push_back(Entry{key, val});
+            try {
+                index.push_back(key_at());
+            } catch (...) {
+                v.pop_back();
+                throw;
+            }
+        }
+    public:
+        ConcurrentRandomDict() = default;
+        ConcurrentRandomDict(const ConcurrentRandomDict&) = delete;
+        ConcurrentRandomDict& operator=(const ConcurrentRandomDict&) = delete;
+
+        [[nodiscard]] size_type size() const noexcept { return v.size(); }
+        int count(const K& key) const {
+            std::lock_guard<std::mutex> lock(writer);
+            return index.find(key, key_at()) == index.npos ? 0 : 1;
+        }
+        void clear() {
+            std::lock_guard<std::mutex> lock(writer);
+            v.clear();
+            index.clear();
+        }
+
+        V at(const K& key) const {
+            std::lock_guard<std::mutex> lock(writer);
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { throw std::out_of_range("ConcurrentRandomDict::at"); }
+            return v.get(index.index_at(slot)).val;
+        }
+
+        int insert(const K& key, const V& val) {
+            std::lock_guard<std::mutex> lock(writer);
+            if (index.find(key, key_at()) != index.npos) { return 0; }
+            append(key, val);
+            return 1;
+        }
+
+        // returns 1 if key was inserted, 0 if its value was overwritten
+        int insert_or_assign(const K& key, const V& val) {
+            std::lock_guard<std::mutex> lock(writer);
+            const size_type slot = index.find(key, key_at());
+            if (slot != index.npos) {
+                v.set(index.index_at(slot), Entry{key, val});
+                return 0;
+            }
+            append(key, val);
+            return 1;
+        }
+
+        int erase(const K& key) {
+            std::lock_guard<std::mutex> lock(writer);
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { return 0; }  // no-op if not found
+            v.erase_swap(index.remove(slot));
+            return 1;
+        }
+
+        std::pair<K, V> random_pair() const {
+            std::optional<Entry> entry = v.random(detail::thread_engine<Engine>());
+            if (!entry) { throw std::runtime_error("empty dictionary"); }
+            return {entry->key, entry->val};
+        }
+
+        // writes k (key, value) pairs drawn with replacement to out, as std::pair<K, V>; see ConcurrentRandomSet::sample
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            auto& rng = detail::thread_engine<Engine>();
+            for (size_type i = 0; i < k; ++i) {
+                std::optional<Entry> entry = v.random(rng);
+                if (!entry) { throw std::runtime_error("empty dictionary"); }
+                *out = std::pair<K, V>{entry->key, entry->val};
+                ++out;
+            }
+            return out;
+        }
+    };
+}
+
+#endif //GSK_CONCURRENTRANDOMDICT_H
@@ -0,0 +1,158 @@
+#ifndef GSK_COWVECTOR_H
+#define GSK_COWVECTOR_H
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <cstddef>
+#include <algorithm>
+
+namespace data_structures::detail {
+    // a vector split into chunks of 2^ChunkBits elements that copies share until they write to them:
+    // copying costs one refcount bump per chunk, and the first write to a shared chunk clones just that chunk
+    // the last chunk grows like a std::vector, so a small CowVector costs no more than a plain one
+    // a copy may be read on another thread while the original keeps writing, as long as each object
+    // stays on one thread; copying the original itself must happen on the thread writing it
+    // chunks can also borrow read-only memory (e.g. a mapped file), which is cloned on the first write the same way
+    template<typename T, std::size_t ChunkBits = 12>
+    class CowVector {
+    public:
+        using value_type = T;
+        using size_type = std::size_t;
+        static constexpr size_type chunk_size = size_type{1} << ChunkBits;
+    private:
+        struct Chunk {
+            std::vector<T> items;  // unless borrowed
+            const T* borrowed{nullptr};
+            size_type borrowed_size{0};
+            std::shared_ptr<const void> keep_alive;  // whatever owns the borrowed memory
+            [[nodiscard]] size_type size() const noexcept { return borrowed ? borrowed_size : items.size(); }
+        };
+        std::vector<std::shared_ptr<Chunk>> _chunks;
+        std::vector<T*> _data;  // where each chunk's elements are, so that reads skip the chunk itself
+        size_type _size{0};
+
+        static constexpr size_type chunk_of(size_type i) noexcept { return i >> ChunkBits; }
+        static constexpr size_type offset_of(size_type i) noexcept { return i & (chunk_size - 1); }
+
+        Chunk& own(size_type c) {
+            std::shared_ptr<Chunk>& chunk = _chunks[c];
+            if (chunk.use_count() > 1 || chunk->borrowed) {
+                auto copy = std::make_shared<Chunk>();
+                copy->items.assign(_data[c], _data[c] + chunk->size());
+                chunk = std::move(copy);
+                _data[c] = chunk->items.data();
+            } else {  // pairs with the release of the last copy that shared this chunk
+                std::atomic_thread_fence(std::memory_order_acquire);
+            }
+            return *chunk;
+        }
+    public:
+        CowVector() = default;
+
+        // a vector over n elements at data, which must stay valid and unchanged for as long as keep_alive lives
+        static CowVector borrow(const T* data, size_type n, std::shared_ptr<const void> keep_alive) {
+            CowVector borrowed;
+            borrowed._chunks.reserve(chunk_of(n + chunk_size - 1));
+            borrowed._data.reserve(chunk_of(n + chunk_size - 1));
+            for (size_type filled = 0; filled < n; filled += chunk_size) {
+                auto chunk = std::make_shared<Chunk>();
+                chunk->borrowed = data + filled;
+                chunk->borrowed_size = std::min(chunk_size, n - filled);
+                chunk->keep_alive = keep_alive;
+                borrowed._chunks.push_back(std::move(chunk));
+                borrowed._data.push_back(const_cast<T*>(data + filled));  // only written after own() replaced it
+            }
+            borrowed._size = n;
+            return borrowed;
+        }
+
+        [[nodiscard]] size_type size() const noexcept { return _size; }
+        [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+
+        const T& operator[](size_type i) const { return _data[chunk_of(i)][offset_of(i)]; }
+        T& operator[](size_type i) {  // unshares the chunk
+            own(chunk_of(i));
+            return _data[chunk_of(i)][offset_of(i)];
+        }
+        const T& back() const { return (*this)[_size - 1]; }
+        T& back() { return (*this)[_size - 1]; }
+
+        // calls f(data, n) for each run of contiguous elements, in order
+        template<typename F>
+        void for_each_chunk(F&& f) const {
+            for (size_type c = 0; c < _chunks.size(); ++c) { f(static_cast<const T*>(_data[c]), _chunks[c]->size()); }
+        }
+
+        template<typename ...Args>
+        T& emplace_back(Args&&... args) {
+            if (_chunks.empty() || _chunks.back()->size() == chunk_size) {
+                _chunks.push_back(std::make_shared<Chunk>());
+                try {
+                    _data.push_back(nullptr);
+                } catch (...) {
+                    _chunks.pop_back();
+                    throw;
+                }
+            }
+            Chunk& chunk = own(_chunks.size() - 1);
+            try {
+                chunk.items.emplace_back(std::forward<Args>(args)...);
+            } catch (...) {
+                if (chunk.items.empty()) {
+                    _chunks.pop_back();
+                    _data.pop_back();
+                }
+                throw;
+            }
+            _data.back() = chunk.items.data();
+            ++_size;
+            return chunk.items.back();
+        }
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        void pop_back() {
+            Chunk& chunk = own(_chunks.size() - 1);
+            chunk.items.pop_back();
+            if (chunk.items.empty()) {
+                _chunks.pop_back();
+                _data.pop_back();
+            }
+            --_size;
+        }
+
+        void clear() noexcept {
+            _chunks.clear();
+            _data.clear();
+            _size = 0;
+        }
+
+        // replaces the contents with n copies of value, in fresh chunks
+        void assign(size_type n, const T& value) {
+            CowVector fresh;
+            fresh._chunks.reserve(chunk_of(n + chunk_size - 1));
+            fresh._data.reserve(chunk_of(n + chunk_size - 1));
+            for (size_type filled = 0; filled < n; filled += chunk_size) {
+                auto chunk = std::make_shared<Chunk>();
+                chunk->items.assign(std::min(chunk_size, n - filled), value);
+                fresh._data.push_back(chunk->items.data());
+                fresh._chunks.push_back(std::move(chunk));
+            }
+            fresh._size = n;
+            *this = std::move(fresh);
+        }
+
+        void reserve(size_type n) {
+            _chunks.reserve(chunk_of(n + chunk_size - 1));
+            _data.reserve(chunk_of(n + chunk_size - 1));
+            if (n <= chunk_size && !_chunks.empty()) {
+                own(0).items.reserve(n);
+                _data[0] = _chunks[0]->items.data();
+            }
+        }
+    };
+}
+
+#endif //GSK_COWVECTOR_H
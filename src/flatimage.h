@@ -0,0 +1,190 @@
+#ifndef GSK_FLATIMAGE_H
+#define GSK_FLATIMAGE_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#if __has_include(<sys/mman.h>) && __has_include(<fcntl.h>) && __has_include(<unistd.h>)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define GSK_FLATIMAGE_MMAP 1
+#endif
+
+#include "cowvector.h"
+
+// images of the flat random containers: the dense array and the index table, byte for byte, so that
+// loading is a matter of pointing CowVectors at them, with no hashing or copying per element
+// an image is only meaningful to a program built with the same element types, Hash and byte order
+namespace data_structures::detail {
+    // elements are written and mapped byte for byte; std::pair is not trivially copyable (its assignment is
+    // user-provided), but a pair of trivially copyable members has trivial copy construction and destruction
+    template<typename E>
+    struct is_image_element: std::is_trivially_copyable<E> {};
+    template<typename A, typename B>
+    struct is_image_element<std::pair<A, B>>:
+            std::bool_constant<std::is_trivially_copyable_v<A> && std::is_trivially_copyable_v<B>> {};
+
+    struct ImageHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byte_order;  // image_byte_order as written
+        std::uint32_t element_size;
+        std::uint32_t element_align;
+        std::uint32_t index_size;  // sizeof the table's size_type
+        float max_load_factor;
+        std::uint64_t size;  // elements in the dense array
+        std::uint64_t capacity;  // slots in the table
+        std::uint64_t hash_check;  // the hash of the first key, to catch a loader with a different Hash
+    };
+    inline constexpr char image_magic[8] = {'G', 'S', 'K', 'F', 'L', 'A', 'T', '\0'};
+    inline constexpr std::uint32_t image_version = 1;
+    inline constexpr std::uint32_t image_byte_order = 0x01020304;
+    inline constexpr std::size_t image_alignment = 64;  // of the header and of every array after it
+    static_assert(sizeof(ImageHeader) <= image_alignment);
+
+    class ImageWriter {
+    private:
+        std::ostream& _out;
+        std::uint64_t _pos{0};
+    public:
+        explicit ImageWriter(std::ostream& out): _out{out} {}
+
+        void write(const void* data, std::size_t bytes) {
+            _out.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            if (!_out) { throw std::runtime_error("image: write failed"); }
+            _pos += bytes;
+        }
+        void pad() {
+            static constexpr char zeros[image_alignment] = {};
+            write(zeros, (image_alignment - _pos % image_alignment) % image_alignment);
+        }
+        template<typename T, std::size_t B>
+        void write_array(const CowVector<T, B>& array) {
+            array.for_each_chunk([this](const T* data, std::size_t n) { write(data, n * sizeof(T)); });
+            pad();
+        }
+    };
+
+    class ImageReader {
+    private:
+        const char* _base;
+        std::size_t _bytes;
+        std::shared_ptr<const void> _keep_alive;
+        std::size_t _pos{0};
+    public:
+        // base must be aligned to image_alignment
+        ImageReader(const void* base, std::size_t bytes, std::shared_ptr<const void> keep_alive):
+            _base{static_cast<const char*>(base)}, _bytes{bytes}, _keep_alive{std::move(keep_alive)} {}
+
+        ImageHeader header() {
+            ImageHeader header{};
+            if (_bytes < image_alignment) { throw std::runtime_error("image: truncated"); }  // the padded header
+            std::memcpy(&header, _base, sizeof(ImageHeader));
+            if (std::memcmp(header.magic, image_magic, sizeof(image_magic)) != 0) {
+                throw std::runtime_error("image: bad magic");
+            }
+            if (header.version != image_version || header.byte_order != image_byte_order) {
+                throw std::runtime_error("image: unsupported version or byte order");
+            }
+            _pos = image_alignment;
+            return header;
+        }
+
+        // n elements of T, borrowed in place
+        template<typename T>
+        CowVector<T> borrow_array(std::uint64_t n) {
+            if (_pos > _bytes || n > (_bytes - _pos) / sizeof(T)) { throw std::runtime_error("image: truncated"); }
+            const auto* data = reinterpret_cast<const T*>(_base + _pos);
+            _pos += static_cast<std::size_t>(n) * sizeof(T);
+            _pos = std::min(_bytes, (_pos + image_alignment - 1) / image_alignment * image_alignment);
+            return CowVector<T>::borrow(data, static_cast<std::size_t>(n), _keep_alive);
+        }
+    };
+
+    // the whole of in, in an aligned buffer
+    inline std::shared_ptr<const void> read_image(std::istream& in, std::size_t& bytes) {
+        std::string contents{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        bytes = contents.size();
+        auto* buffer = static_cast<char*>(::operator new(bytes ? bytes : 1, std::align_val_t{image_alignment}));
+        std::memcpy(buffer, contents.data(), bytes);
+        return {buffer, [](const void* p) { ::operator delete(const_cast<void*>(p), std::align_val_t{image_alignment}); }};
+    }
+
+    // a read-only mapping of the file at path, or the file read into memory where mmap is unavailable
+    inline std::shared_ptr<const void> map_image(const std::string& path, std::size_t& bytes) {
+#ifdef GSK_FLATIMAGE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { throw std::runtime_error("image: cannot open " + path); }
+        struct stat st{};
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("image: cannot stat " + path);
+        }
+        bytes = static_cast<std::size_t>(st.st_size);
+        void* addr = bytes ? ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        ::close(fd);  // the mapping keeps the file alive
+        if (addr == MAP_FAILED) { throw std::runtime_error("image: cannot map " + path); }
+        const std::size_t length = bytes;
+        return {addr, [length](const void* p) { if (p) { ::munmap(const_cast<void*>(p), length); } }};
+#else
+        std::ifstream in(path, std::ios::binary);
+        if (!in) { throw std::runtime_error("image: cannot open " + path); }
+        return read_image(in, bytes);
+#endif
+    }
+
+    // writes the dense array v and its DenseIndex
+    template<typename E, typename Index>
+    void save_image(std::ostream& out, const CowVector<E>& v, const Index& index, std::uint64_t hash_check) {
+        static_assert(is_image_element<E>::value, "images hold the elements byte for byte");
+        ImageHeader header{};
+        std::memcpy(header.magic, image_magic, sizeof(image_magic));
+        header.version = image_version;
+        header.byte_order = image_byte_order;
+        header.element_size = sizeof(E);
+        header.element_align = alignof(E);
+        header.index_size = sizeof(typename Index::size_type);
+        header.max_load_factor = index.max_load_factor();
+        header.size = v.size();
+        header.capacity = index.capacity();
+        header.hash_check = hash_check;
+        ImageWriter writer{out};
+        writer.write(&header, sizeof(header));
+        writer.pad();
+        writer.write_array(v);
+        index.visit([&](const auto& array) { writer.write_array(array); });
+    }
+
+    // the inverse of save_image; returns the header so that the caller can check hash_check
+    template<typename E, typename Index>
+    ImageHeader load_image(ImageReader& reader, CowVector<E>& v, Index& index) {
+        static_assert(is_image_element<E>::value, "images hold the elements byte for byte");
+        static_assert(alignof(E) <= image_alignment);
+        const ImageHeader header = reader.header();
+        if (header.element_size != sizeof(E) || header.element_align != alignof(E)
+            || header.index_size != sizeof(typename Index::size_type)) {
+            throw std::runtime_error("image: element types do not match");
+        }
+        v = reader.borrow_array<E>(header.size);
+        auto table = reader.borrow_array<typename Index::table_array::value_type>(header.capacity);
+        auto dist = reader.borrow_array<typename Index::dist_array::value_type>(header.capacity);
+        auto slot_of = reader.borrow_array<typename Index::table_array::value_type>(header.size);
+        index.adopt(std::move(table), std::move(dist), std::move(slot_of), header.max_load_factor);
+        return header;
+    }
+}
+
+#endif //GSK_FLATIMAGE_H
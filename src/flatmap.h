@@ -0,0 +1,599 @@
+#ifndef GSK_FLATMAP_H
+#define GSK_FLATMAP_H
+
+#include <memory>
+#include <utility>
+#include <functional>
+#include <stdexcept>
+#include <limits>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+#include <unordered_map>
+
+#include "cowvector.h"
+#include "stats.h"
+
+namespace data_structures::detail {
+    // whether Hash and KeyEqual both take keys other than the key type (e.g. std::string_view for std::string),
+    // so that lookups by KT need not build a key; KT only makes the answer dependent, for SFINAE
+    template<typename Hash, typename KeyEqual, typename KT, typename = void>
+    struct is_transparent: std::false_type {};
+    template<typename Hash, typename KeyEqual, typename KT>
+    struct is_transparent<Hash, KeyEqual, KT,
+            std::void_t<typename Hash::is_transparent, typename KeyEqual::is_transparent>>: std::true_type {};
+
+    // std::unordered_map only looks up other key types from C++20 on
+#ifdef __cpp_lib_generic_unordered_lookup
+    inline constexpr bool unordered_heterogeneous = true;
+#else
+    inline constexpr bool unordered_heterogeneous = false;
+#endif
+
+    template<typename Alloc, typename T>
+    using rebind_alloc_t = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+    // enables a lookup by KT: always for K itself, and for other types if the table can hash and compare them
+    template<typename KT, typename K, typename Hash, typename KeyEqual, bool Heterogeneous>
+    using enable_lookup_t = std::enable_if_t<
+            std::is_same_v<KT, K> || (Heterogeneous && is_transparent<Hash, KeyEqual, KT>::value), int>;
+}
+
+namespace data_structures {
+    // an open-addressing hash map with Robin Hood probing and backward-shift deletion (no tombstones)
+    // entries live in one flat array, so a successful lookup touches a cache line or two instead of chasing nodes
+    // unlike std::unordered_map, insertion and erasure invalidate every iterator, pointer and reference
+    // both arrays come from Alloc, rebound as needed
+    template<typename K, typename V, typename Hash=std::hash<K>, typename KeyEqual=std::equal_to<K>,
+            typename Alloc=std::allocator<std::pair<K, V>>>
+    class FlatMap {
+    public:
+        using key_type = K;
+        using mapped_type = V;
+        using value_type = std::pair<K, V>;  // keys must not be modified through iterators
+        using size_type = std::size_t;
+        using allocator_type = detail::rebind_alloc_t<Alloc, value_type>;
+    private:
+        using dist_type = std::uint16_t;
+        static constexpr dist_type max_dist = std::numeric_limits<dist_type>::max();
+        static constexpr size_type npos = std::numeric_limits<size_type>::max();
+        static constexpr size_type min_capacity = 8;
+        using slot_alloc = allocator_type;
+        using slot_traits = std::allocator_traits<slot_alloc>;
+        using dist_alloc = typename slot_traits::template rebind_alloc<dist_type>;
+
+        slot_alloc _slot_alloc;
+        dist_alloc _dist_alloc;
+        value_type* _slots{nullptr};
+        dist_type* _dist{nullptr};  // 0 for an empty slot, otherwise 1 + the distance from the home slot
+        size_type _capacity{};  // zero or a power of two
+        unsigned _shift{};  // 64 - log2(_capacity)
+        size_type _size{};
+        float _max_load_factor{0.875f};
+        Hash _hash;
+        KeyEqual _eq;
+
+        // spreads the hash over the high bits, so that identity hashes (e.g. std::hash<int>) probe well
+        template<typename KT>
+        [[nodiscard]] size_type home(const KT& key) const {
+            return static_cast<size_type>((static_cast<std::uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull) >> _shift);
+        }
+        [[nodiscard]] size_type next(size_type i) const noexcept { return (i + 1) & (_capacity - 1); }
+        [[nodiscard]] size_type max_elements(size_type capacity) const noexcept {
+            return static_cast<size_type>(static_cast<float>(capacity) * _max_load_factor);
+        }
+
+        template<typename KT>
+        [[nodiscard]] size_type find_index(const KT& key) const {
+            if (_size == 0) { return npos; }
+            size_type i = home(key);
+            for (unsigned d = 1; d <= _dist[i]; ++d, i = next(i)) {  // a richer slot ends the probe sequence
+                if (_dist[i] == d && _eq(_slots[i].first, key)) { return i; }
+            }
+            return npos;
+        }
+
+        // Robin Hood insertion of an absent key: the cluster from the first richer slot on shifts one slot up
+        // returns where value ends up, or npos (leaving everything untouched) if a probe distance would overflow
+        size_type place(value_type&& value) {
+            size_type i = home(value.first);
+            unsigned d = 1;
+            for (; _dist[i] >= d; ++d, i = next(i)) {
+                if (d == max_dist) { return npos; }
+            }
+            size_type empty = i;
+            for (; _dist[empty]; empty = next(empty)) {
+                if (_dist[empty] == max_dist) { return npos; }
+            }
+            for (size_type j = empty; j != i;) {
+                const size_type prev = (j - 1) & (_capacity - 1);
+                slot_traits::construct(_slot_alloc, _slots + j, std::move(_slots[prev]));
+                slot_traits::destroy(_slot_alloc, _slots + prev);
+                _dist[j] = _dist[prev] + 1;
+                j = prev;
+            }
+            slot_traits::construct(_slot_alloc, _slots + i, std::move(value));
+            _dist[i] = static_cast<dist_type>(d);
+            return i;
+        }
+
+        size_type insert_new(value_type&& value) {
+            if (_size + 1 > max_elements(_capacity)) {
+                rehash_to(std::max(min_capacity, _capacity * 2));
+            }
+            for (;;) {
+                size_type at = place(std::move(value));
+                if (at != npos) {
+                    ++_size;
+                    return at;
+                }
+                if (_size < max_elements(_capacity) / 2) {  // growing will not help; the hash is broken
+                    throw std::overflow_error("FlatMap: probe sequence overflow");
+                }
+                rehash_to(_capacity * 2);
+            }
+        }
+
+        void erase_index(size_type i) {
+            slot_traits::destroy(_slot_alloc, _slots + i);
+            for (size_type j = next(i); _dist[j] > 1; i = j, j = next(j)) {  // shift the cluster one slot back
+                slot_traits::construct(_slot_alloc, _slots + i, std::move(_slots[j]));
+                slot_traits::destroy(_slot_alloc, _slots + j);
+                _dist[i] = _dist[j] - 1;
+            }
+            _dist[i] = 0;
+            --_size;
+        }
+
+        void allocate(size_type capacity) {
+            _capacity = capacity;
+            _shift = 64;
+            for (size_type c = capacity; c > 1; c >>= 1) { --_shift; }
+            _slots = capacity ? slot_traits::allocate(_slot_alloc, capacity) : nullptr;
+            _dist = capacity ? std::allocator_traits<dist_alloc>::allocate(_dist_alloc, capacity) : nullptr;
+            std::fill(_dist, _dist + capacity, dist_type{0});
+        }
+
+        void deallocate() noexcept {
+            if (_capacity) {
+                slot_traits::deallocate(_slot_alloc, _slots, _capacity);
+                std::allocator_traits<dist_alloc>::deallocate(_dist_alloc, _dist, _capacity);
+            }
+            _slots = nullptr;
+            _dist = nullptr;
+            _capacity = 0;
+        }
+
+        void rehash_to(size_type capacity) {
+            value_type* old_slots = _slots;
+            dist_type* old_dist = _dist;
+            const size_type old_capacity = _capacity;
+            allocate(capacity);
+            for (size_type i = 0; i < old_capacity; ++i) {
+                if (old_dist[i]) {
+                    // only a cluster of max_dist colliding keys gets here, leaving the map in an unspecified state
+                    if (place(std::move(old_slots[i])) == npos) { throw std::overflow_error("FlatMap: probe sequence overflow"); }
+                    slot_traits::destroy(_slot_alloc, old_slots + i);
+                }
+            }
+            if (old_capacity) {
+                slot_traits::deallocate(_slot_alloc, old_slots, old_capacity);
+                std::allocator_traits<dist_alloc>::deallocate(_dist_alloc, old_dist, old_capacity);
+            }
+        }
+
+        [[nodiscard]] size_type first_occupied(size_type i) const noexcept {
+            while (i < _capacity && !_dist[i]) { ++i; }
+            return i;
+        }
+
+    public:
+        template<bool Const>
+        class Iterator {
+            friend class FlatMap;
+            template<bool> friend class Iterator;
+            using map_type = std::conditional_t<Const, const FlatMap, FlatMap>;
+            map_type* _map{nullptr};
+            size_type _idx{};
+            Iterator(map_type* map, size_type idx): _map{map}, _idx{idx} {}
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = FlatMap::value_type;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::conditional_t<Const, const value_type&, value_type&>;
+            using pointer = std::conditional_t<Const, const value_type*, value_type*>;
+
+            Iterator() = default;
+            template<bool C=Const, std::enable_if_t<C, bool> = true>
+            Iterator(const Iterator<false>& other): _map{other._map}, _idx{other._idx} {}
+
+            reference operator*() const { return _map->_slots[_idx]; }
+            pointer operator->() const { return _map->_slots + _idx; }
+            Iterator& operator++() {
+                _idx = _map->first_occupied(_idx + 1);
+                return *this;
+            }
+            Iterator operator++(int) {
+                Iterator old = *this;
+                ++*this;
+                return old;
+            }
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs._idx == rhs._idx; }
+            friend bool operator!=(const Iterator& lhs, const Iterator& rhs) { return lhs._idx != rhs._idx; }
+        };
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        FlatMap() = default;
+        explicit FlatMap(size_type n) { reserve(n); }
+        explicit FlatMap(const allocator_type& alloc): _slot_alloc{alloc}, _dist_alloc{alloc} {}
+
+        // the copy has the same capacity, which means every element can be copied over to the same slot
+        FlatMap(const FlatMap& other):
+            _slot_alloc{slot_traits::select_on_container_copy_construction(other._slot_alloc)},
+            _dist_alloc{_slot_alloc}, _max_load_factor{other._max_load_factor}, _hash{other._hash}, _eq{other._eq} {
+            allocate(other._capacity);
+            for (size_type i = 0; i < _capacity; ++i) {
+                if (other._dist[i]) {
+                    slot_traits::construct(_slot_alloc, _slots + i, other._slots[i]);
+                    _dist[i] = other._dist[i];
+                    ++_size;
+                }
+            }
+        }
+        FlatMap(FlatMap&& other) noexcept:
+            _slot_alloc{std::move(other._slot_alloc)}, _dist_alloc{std::move(other._dist_alloc)}, _slots{std::exchange(other._slots, nullptr)}, _dist{std::exchange(other._dist, nullptr)},
+            _capacity{std::exchange(other._capacity, 0)}, _shift{other._shift}, _size{std::exchange(other._size, 0)},
+            _max_load_factor{other._max_load_factor}, _hash{std::move(other._hash)}, _eq{std::move(other._eq)} {}
+
+        FlatMap& operator=(const FlatMap& other) {
+            if (this != &other) {
+                FlatMap copy{other};
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+        // the arrays change hands unless the allocators differ and stay put, as with std::pmr; then the elements move
+        FlatMap& operator=(FlatMap&& other) noexcept(slot_traits::propagate_on_container_move_assignment::value
+                                                     || slot_traits::is_always_equal::value) {
+            if (this == &other) { return *this; }
+            if (!slot_traits::propagate_on_container_move_assignment::value && _slot_alloc != other._slot_alloc) {
+                clear();
+                _max_load_factor = other._max_load_factor;
+                _hash = std::move(other._hash);
+                _eq = std::move(other._eq);
+                reserve(other._size);
+                for (size_type i = 0; i < other._capacity; ++i) {
+                    if (other._dist[i]) { insert_new(std::move(other._slots[i])); }
+                }
+                other.clear();
+                return *this;
+            }
+            clear();
+            deallocate();
+            if constexpr (slot_traits::propagate_on_container_move_assignment::value) {
+                _slot_alloc = std::move(other._slot_alloc);
+                _dist_alloc = std::move(other._dist_alloc);
+            }
+            _slots = std::exchange(other._slots, nullptr);
+            _dist = std::exchange(other._dist, nullptr);
+            _capacity = std::exchange(other._capacity, 0);
+            _shift = other._shift;
+            _size = std::exchange(other._size, 0);
+            _max_load_factor = other._max_load_factor;
+            _hash = std::move(other._hash);
+            _eq = std::move(other._eq);
+            return *this;
+        }
+
+        ~FlatMap() {
+            clear();
+            deallocate();
+        }
+
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return _slot_alloc; }
+
+        iterator begin() noexcept { return {this, first_occupied(0)}; }
+        iterator end() noexcept { return {this, _capacity}; }
+        const_iterator begin() const noexcept { return {this, first_occupied(0)}; }
+        const_iterator end() const noexcept { return {this, _capacity}; }
+
+        [[nodiscard]] size_type size() const noexcept { return _size; }
+        [[nodiscard]] bool empty() const noexcept { return _size == 0; }
+        [[nodiscard]] size_type capacity() const noexcept { return _capacity; }
+        [[nodiscard]] float load_factor() const noexcept {
+            return _capacity ? static_cast<float>(_size) / static_cast<float>(_capacity) : 0.0f;
+        }
+        // the probe length of a key is its distance from its home slot, plus one
+        [[nodiscard]] ProbeStats probe_stats() const noexcept {
+            ProbeStats stats;
+            stats.keys = _size;
+            stats.slots = _capacity;
+            std::size_t total = 0;
+            for (size_type i = 0; i < _capacity; ++i) {
+                total += _dist[i];
+                stats.max_probe = std::max<std::size_t>(stats.max_probe, _dist[i]);
+            }
+            stats.mean_probe = _size ? static_cast<double>(total) / static_cast<double>(_size) : 0.0;
+            return stats;
+        }
+        [[nodiscard]] float max_load_factor() const noexcept { return _max_load_factor; }
+        void max_load_factor(float ml) {
+            if (!(ml > 0.0f && ml <= 1.0f)) { throw std::invalid_argument("max load factor must be in (0, 1]"); }
+            _max_load_factor = ml;
+            reserve(_size);
+        }
+
+        // makes room for n elements without any further rehash
+        void reserve(size_type n) {
+            size_type capacity = n ? min_capacity : 0;
+            while (max_elements(capacity) < n) { capacity *= 2; }
+            if (capacity > _capacity) { rehash_to(capacity); }
+        }
+
+        void clear() noexcept {
+            for (size_type i = 0; i < _capacity; ++i) {
+                if (_dist[i]) {
+                    slot_traits::destroy(_slot_alloc, _slots + i);
+                    _dist[i] = 0;
+                }
+            }
+            _size = 0;
+        }
+
+        // the lookups below also take any KT that transparent Hash and KeyEqual accept
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, true>;
+
+        iterator find(const K& key) { return find<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        iterator find(const KT& key) {
+            size_type i = find_index(key);
+            return {this, i == npos ? _capacity : i};
+        }
+        const_iterator find(const K& key) const { return find<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        const_iterator find(const KT& key) const {
+            size_type i = find_index(key);
+            return {this, i == npos ? _capacity : i};
+        }
+        [[nodiscard]] size_type count(const K& key) const { return count<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        [[nodiscard]] size_type count(const KT& key) const { return find_index(key) == npos ? 0 : 1; }
+        [[nodiscard]] bool contains(const K& key) const { return contains<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        [[nodiscard]] bool contains(const KT& key) const { return find_index(key) != npos; }
+
+        V& at(const K& key) { return at<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        V& at(const KT& key) {
+            size_type i = find_index(key);
+            if (i == npos) { throw std::out_of_range("FlatMap::at"); }
+            return _slots[i].second;
+        }
+        const V& at(const K& key) const { return at<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        const V& at(const KT& key) const {
+            size_type i = find_index(key);
+            if (i == npos) { throw std::out_of_range("FlatMap::at"); }
+            return _slots[i].second;
+        }
+
+        template<typename KT, typename ...Arg>
+        std::pair<iterator, bool> try_emplace(KT&& key, Arg&&... args) {
+            size_type i;
+            if constexpr (detail::is_transparent<Hash, KeyEqual, KT>::value) {
+                i = find_index(key);  // no key is built unless it goes in
+            } else {
+                i = find_index(static_cast<const K&>(key));
+            }
+            if (i != npos) { return {{this, i}, false}; }
+            value_type value(std::piecewise_construct, std::forward_as_tuple(std::forward<KT>(key)),
+                             std::forward_as_tuple(std::forward<Arg>(args)...));
+            return {{this, insert_new(std::move(value))}, true};
+        }
+
+        template<typename ...Arg>
+        std::pair<iterator, bool> emplace(Arg&&... args) {
+            value_type value(std::forward<Arg>(args)...);
+            size_type i = find_index(value.first);
+            if (i != npos) { return {{this, i}, false}; }
+            return {{this, insert_new(std::move(value))}, true};
+        }
+
+        V& operator[](const K& key) { return try_emplace(key).first->second; }
+
+        void erase(const_iterator pos) { erase_index(pos._idx); }
+        size_type erase(const K& key) { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0,
+                std::enable_if_t<!std::is_convertible_v<const KT&, const_iterator>, int> = 0>
+        size_type erase(const KT& key) {
+            size_type i = find_index(key);
+            if (i == npos) { return 0; }
+            erase_index(i);
+            return 1;
+        }
+    };
+}
+
+namespace data_structures::detail {
+    template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc>
+    ProbeStats probe_stats(const FlatMap<K, V, Hash, KeyEqual, Alloc>& m) { return m.probe_stats(); }
+
+    // a Robin Hood table of indices into a dense array owned by someone else, which is where the keys live
+    // (key_at resolves a dense index to its key); the slot of every dense index is recorded as well, so that
+    // the owner can erase with swap-with-last without probing for the moved element
+    template<typename Hash, typename KeyEqual>
+    class DenseIndex {
+    public:
+        using size_type = std::size_t;
+        static constexpr size_type npos = std::numeric_limits<size_type>::max();
+    private:
+        using dist_type = std::uint16_t;
+        static constexpr dist_type max_dist = std::numeric_limits<dist_type>::max();
+        static constexpr size_type min_capacity = 8;
+        // copy-on-write, so that copies of the owning container share the untouched parts of the table
+        CowVector<size_type> _table;  // dense index per slot
+        CowVector<dist_type> _dist;  // 0 for an empty slot, otherwise 1 + the distance from the home slot
+        CowVector<size_type> _slot_of;  // slot per dense index
+        unsigned _shift{64};
+        float _max_load_factor{0.875f};
+        Hash _hash;
+        KeyEqual _eq;
+
+        template<typename KT>
+        [[nodiscard]] size_type home(const KT& key) const {
+            return static_cast<size_type>((static_cast<std::uint64_t>(_hash(key)) * 0x9E3779B97F4A7C15ull) >> _shift);
+        }
+        [[nodiscard]] size_type next(size_type i) const noexcept { return (i + 1) & (capacity() - 1); }
+        [[nodiscard]] size_type max_elements(size_type capacity) const noexcept {
+            return static_cast<size_type>(static_cast<float>(capacity) * _max_load_factor);
+        }
+        void set(size_type slot, size_type idx, dist_type d) {
+            _table[slot] = idx;
+            _dist[slot] = d;
+            _slot_of[idx] = slot;
+        }
+        // the same insertion by shifting as FlatMap::place
+        template<typename KeyAt>
+        bool place(size_type idx, const KeyAt& key_at) {
+            const auto& dist = _dist;  // probe without unsharing
+            size_type i = home(key_at(idx));
+            unsigned d = 1;
+            for (; dist[i] >= d; ++d, i = next(i)) {
+                if (d == max_dist) { return false; }
+            }
+            size_type empty = i;
+            for (; dist[empty]; empty = next(empty)) {
+                if (dist[empty] == max_dist) { return false; }
+            }
+            for (size_type j = empty; j != i;) {
+                const size_type prev = (j - 1) & (capacity() - 1);
+                set(j, std::as_const(_table)[prev], dist[prev] + 1);
+                j = prev;
+            }
+            set(i, idx, static_cast<dist_type>(d));
+            return true;
+        }
+        template<typename KeyAt>
+        void rehash_to(size_type capacity, const KeyAt& key_at) {
+            _table.assign(capacity, 0);
+            _dist.assign(capacity, 0);
+            _shift = 64;
+            for (size_type c = capacity; c > 1; c >>= 1) { --_shift; }
+            for (size_type idx = 0; idx < _slot_of.size(); ++idx) {
+                if (!place(idx, key_at)) { throw std::overflow_error("DenseIndex: probe sequence overflow"); }
+            }
+        }
+    public:
+        [[nodiscard]] size_type size() const noexcept { return _slot_of.size(); }
+        [[nodiscard]] size_type capacity() const noexcept { return _table.size(); }
+
+        // for images of the table (see flatimage.h): the raw arrays, and a table rebuilt from them
+        // adopt hashes nothing, so the arrays must come from visit on a DenseIndex with an equivalent Hash
+        using table_array = CowVector<size_type>;
+        using dist_array = CowVector<dist_type>;
+        template<typename F>
+        void visit(F&& f) const {
+            f(_table);
+            f(_dist);
+            f(_slot_of);
+        }
+        [[nodiscard]] float max_load_factor() const noexcept { return _max_load_factor; }
+        // the arrays may come from a file, so every index in them is checked against the others, in O(capacity)
+        void adopt(table_array table, dist_array dist, table_array slot_of, float max_load_factor) {
+            const size_type capacity = table.size();
+            const size_type n = slot_of.size();
+            if (dist.size() != capacity || (capacity & (capacity - 1)) || !(max_load_factor > 0 && max_load_factor <= 1)
+                || static_cast<float>(capacity) * max_load_factor < static_cast<float>(n)) {
+                throw std::invalid_argument("DenseIndex: inconsistent arrays");
+            }
+            size_type occupied = 0;
+            for (size_type slot = 0; slot < capacity; ++slot) {
+                if (!dist[slot]) { continue; }
+                const size_type idx = table[slot];
+                if (idx >= n || slot_of[idx] != slot) { throw std::invalid_argument("DenseIndex: inconsistent arrays"); }
+                ++occupied;
+            }
+            if (occupied != n) {  // with the above, slot_of maps every dense index to a distinct occupied slot
+                throw std::invalid_argument("DenseIndex: inconsistent arrays");
+            }
+            _table = std::move(table);
+            _dist = std::move(dist);
+            _slot_of = std::move(slot_of);
+            _max_load_factor = max_load_factor;
+            _shift = 64;
+            for (size_type c = capacity; c > 1; c >>= 1) { --_shift; }
+        }
+        template<typename KT>
+        [[nodiscard]] std::uint64_t hash_of(const KT& key) const { return static_cast<std::uint64_t>(_hash(key)); }
+
+        // the slot holding key, or npos
+        template<typename KT, typename KeyAt>
+        [[nodiscard]] size_type find(const KT& key, const KeyAt& key_at) const {
+            if (_slot_of.empty()) { return npos; }
+            size_type i = home(key);
+            for (unsigned d = 1; d <= _dist[i]; ++d, i = next(i)) {
+                if (_dist[i] == d && _eq(key_at(_table[i]), key)) { return i; }
+            }
+            return npos;
+        }
+
+        [[nodiscard]] size_type index_at(size_type slot) const { return _table[slot]; }
+        [[nodiscard]] size_type slot_of(size_type idx) const { return _slot_of[idx]; }
+
+        // registers the element just appended to the dense array, whose key must be absent
+        template<typename KeyAt>
+        void push_back(const KeyAt& key_at) {
+            const size_type idx = _slot_of.size();
+            _slot_of.push_back(npos);
+            if (idx + 1 > max_elements(capacity())) {  // places idx along with everything else
+                rehash_to(std::max(min_capacity, capacity() * 2), key_at);
+                return;
+            }
+            if (place(idx, key_at)) { return; }
+            if (idx < max_elements(capacity()) / 2) {  // growing will not help; the hash is broken
+                _slot_of.pop_back();
+                throw std::overflow_error("DenseIndex: probe sequence overflow");
+            }
+            rehash_to(capacity() * 2, key_at);
+        }
+
+        // unregisters the dense index in slot and re-points the last dense index to it,
+        // i.e. the owner is expected to move its last element into the returned index and pop the back
+        size_type remove(size_type slot) {
+            const size_type idx = _table[slot];
+            const auto& dist = _dist;
+            size_type i = slot;
+            for (size_type j = next(i); dist[j] > 1; i = j, j = next(j)) {  // backward shift
+                set(i, std::as_const(_table)[j], dist[j] - 1);
+            }
+            _dist[i] = 0;
+            const size_type last = _slot_of.size() - 1;
+            if (idx != last) {
+                _table[std::as_const(_slot_of)[last]] = idx;
+                _slot_of[idx] = std::as_const(_slot_of)[last];
+            }
+            _slot_of.pop_back();
+            return idx;
+        }
+
+        void clear() noexcept {
+            _table.clear();
+            _dist.clear();
+            _slot_of.clear();
+        }
+
+        template<typename KeyAt>
+        void reserve(size_type n, const KeyAt& key_at) {
+            size_type capacity = n ? min_capacity : 0;
+            while (max_elements(capacity) < n) { capacity *= 2; }
+            if (capacity > this->capacity()) { rehash_to(capacity, key_at); }
+            _slot_of.reserve(n);
+        }
+    };
+}
+
+#endif //GSK_FLATMAP_H
@@ -5,45 +5,263 @@
 #include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
+#include <memory>
+#include <new>
+#include <optional>
+#include <functional>
+#include <cassert>
+#include <iterator>
+#include <array>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+#include "flatmap.h"
+#include "heapsimd.h"
+#include "stats.h"
 
 namespace data_structures::detail {
-    template<typename T>
+    template<typename T, typename P>
     struct EntryBase {
         template<typename ...Arg>
-        explicit EntryBase(double time, Arg&&... args): time{time}, payload{std::forward<Arg>(args)...} {}
-        double time;
+        explicit EntryBase(P time, Arg&&... args): time{std::move(time)}, payload{std::forward<Arg>(args)...} {}
+        P time;
         T payload;
     };
 
-    template<typename T>
-    struct LazyEntry: public EntryBase<T> {
+    template<typename T, typename P>
+    struct LazyEntry: public EntryBase<T, P> {
         template<typename ...Arg>
-        explicit LazyEntry(double time, Arg&&... args): EntryBase<T>(time, std::forward<Arg>(args)...), exist{true} {}
+        explicit LazyEntry(P time, Arg&&... args): EntryBase<T, P>(std::move(time), std::forward<Arg>(args)...), exist{true} {}
         bool exist;
     };
 
-    template<typename T>
-    struct EagerEntry: public EntryBase<T> {
-        using size_type = typename std::vector<EagerEntry<T>*>::size_type;
+    template<typename T, typename P>
+    struct EagerEntry: public EntryBase<T, P> {
+        using size_type = typename std::vector<EagerEntry<T, P>*>::size_type;
         template<typename ...Arg>
-        EagerEntry(size_type loc, double time, Arg&&... args): loc{loc}, EntryBase<T>(time, std::forward<Arg>(args)...){}
+        EagerEntry(size_type loc, P time, Arg&&... args): EntryBase<T, P>(std::move(time), std::forward<Arg>(args)...), loc{loc} {}
         size_type loc;  // an eager entry keeps track of its index in the vector
     };
 
-    template<typename T>
-    inline bool compare(const EntryBase<T>* e1, const EntryBase<T>* e2) {
-        // true if e1 less than e2 => turn into a min-heap
-        return e1->time > e2->time;
+    template<typename T, typename P>
+    struct RadixEntry: public EntryBase<T, P> {
+        using size_type = typename std::vector<RadixEntry<T, P>*>::size_type;
+        template<typename ...Arg>
+        RadixEntry(unsigned bucket, size_type loc, P time, Arg&&... args):
+            EntryBase<T, P>(std::move(time), std::forward<Arg>(args)...), bucket{bucket}, loc{loc} {}
+        unsigned bucket;  // a radix entry keeps track of its bucket and its index in that bucket
+        size_type loc;
+    };
+
+    template<typename T, typename P>
+    struct PairingEntry: public EntryBase<T, P> {
+        template<typename ...Arg>
+        explicit PairingEntry(P time, Arg&&... args): EntryBase<T, P>(std::move(time), std::forward<Arg>(args)...) {}
+        PairingEntry* child{nullptr};  // the leftmost child
+        PairingEntry* next{nullptr};  // the right sibling
+        PairingEntry* prev{nullptr};  // the left sibling, or the parent of a leftmost child
+    };
+
+    // number of bits needed to represent x; 0 for x==0
+    inline unsigned bit_width(std::uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return x ? 64u - static_cast<unsigned>(__builtin_clzll(x)) : 0u;
+#else
+        unsigned width = 0;
+        for (; x; x >>= 1) { ++width; }
+        return width;
+#endif
+    }
+
+    // counts the entries of a d-ary heap satisfying due, which must be closed under taking parents;
+    // only those entries and their children are visited
+    template<std::size_t Arity, typename Heap, typename Due>
+    std::size_t count_due(const Heap& heap, Due&& due) {
+        if (heap.empty() || !due(heap[0])) { return 0; }
+        std::size_t count = 0;
+        std::vector<std::size_t> stack{0};
+        while (!stack.empty()) {
+            const std::size_t i = stack.back();
+            stack.pop_back();
+            ++count;
+            const std::size_t last = std::min(Arity*i + 1 + Arity, heap.size());
+            for (std::size_t c = Arity*i + 1; c < last; ++c) {
+                if (due(heap[c])) { stack.push_back(c); }
+            }
+        }
+        return count;
+    }
+
+    // hands a popped (priority, payload) to sink: a callable, or else an output iterator of pairs
+    template<typename Sink, typename P, typename T>
+    void emit(Sink& sink, P&& time, T&& payload) {
+        if constexpr(std::is_invocable_v<Sink&, P&&, T&&>) {
+            sink(std::forward<P>(time), std::forward<T>(payload));
+        } else {
+            *sink = std::pair<std::decay_t<P>, std::decay_t<T>>{ std::forward<P>(time), std::forward<T>(payload) };
+            ++sink;
+        }
     }
+
+    // moves the contents of detached entries into sink in order, recycling each entry afterwards
+    // if sink throws, the entries not delivered yet are dropped
+    template<typename It, typename Pool, typename Sink>
+    void deliver(It first, It last, Pool& pool, Sink& sink) {
+        for (; first != last; ++first) {
+            try {
+                emit(sink, std::move((*first)->time), std::move((*first)->payload));
+            } catch (...) {
+                for (; first != last; ++first) { pool.destroy(*first); }
+                throw;
+            }
+            pool.destroy(*first);
+        }
+    }
+
+    template<typename Compare>
+    struct EntryCompare {
+        Compare cmp;
+        // true if e1 less than e2 => turn the max-heaps of <algorithm> into min-heaps w.r.t. cmp
+        template<typename E>
+        bool operator()(const E* e1, const E* e2) const { return cmp(e2->time, e1->time); }
+    };
+
+    // Index::heterogeneous, or false for index policies that do not say
+    template<typename Index, typename = void>
+    struct index_heterogeneous: std::false_type {};
+    template<typename Index>
+    struct index_heterogeneous<Index, std::void_t<decltype(Index::heterogeneous)>>:
+            std::bool_constant<Index::heterogeneous> {};
 }
 
 namespace data_structures {
-    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>>
-    class QueueBase {
-    protected:
+    // a free-list slab pool that queue entries are carved out of
+    // slabs grow geometrically and are only released when the pool dies; freed slots are recycled LIFO
+    // a pool can be shared by several queues of the same entry type (NOT thread-safe)
+    // slabs, and the list of them, come from Alloc
+    template<typename E, typename Alloc=std::allocator<E>>
+    class EntryPool {
+    private:
+        union Slot {
+            Slot* next;
+            alignas(E) unsigned char storage[sizeof(E)];
+        };
+        struct Slab {
+            Slot* slots;
+            std::size_t size;
+        };
+        using slot_alloc = detail::rebind_alloc_t<Alloc, Slot>;
+        using slot_traits = std::allocator_traits<slot_alloc>;
+        static constexpr std::size_t min_slab_size = 32;
+        slot_alloc _alloc;
+        std::vector<Slab, detail::rebind_alloc_t<Alloc, Slab>> _slabs;
+        Slot* _free{nullptr};
+        std::size_t _capacity{};
+
+        void grow(std::size_t n) {
+            _slabs.reserve(_slabs.size() + 1);  // so that nothing throws once the slab is allocated
+            Slot* slab = slot_traits::allocate(_alloc, n);
+            for (std::size_t i = n; i-- > 0;) {  // thread backwards so that slots are handed out in address order
+                slab[i].next = _free;
+                _free = &slab[i];
+            }
+            _slabs.push_back({slab, n});
+            _capacity += n;
+        }
+    public:
+        using allocator_type = Alloc;
+
+        EntryPool() = default;
+        explicit EntryPool(const Alloc& alloc): _alloc(alloc), _slabs(alloc) {}
+        EntryPool(const EntryPool& other) = delete;
+        EntryPool& operator=(const EntryPool& other) = delete;
+        // takes over other's slabs, with the entries living in them, and leaves it empty
+        EntryPool(EntryPool&& other) noexcept:
+            _alloc(std::move(other._alloc)), _slabs(std::move(other._slabs)),
+            _free(std::exchange(other._free, nullptr)), _capacity(std::exchange(other._capacity, 0)) {
+            other._slabs.clear();
+        }
+        EntryPool& operator=(EntryPool&& other) = delete;
+        ~EntryPool() {  // entries still alive are NOT destroyed; that is up to their owner
+            for (const Slab& slab: _slabs) { slot_traits::deallocate(_alloc, slab.slots, slab.size); }
+        }
+
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(_alloc); }
+
+        // make sure at least n slots exist in total, one slab at most
+        void reserve(std::size_t n) {
+            if (n > _capacity) { grow(n - _capacity); }
+        }
+
+        template<typename ...Arg>
+        E* create(Arg&&... args) {
+            if (!_free) { grow(std::max(min_slab_size, _capacity)); }
+            Slot* slot = _free;
+            _free = slot->next;  // storage overlaps next; unlink before constructing
+            try {
+                return new (slot->storage) E(std::forward<Arg>(args)...);
+            } catch (...) {
+                slot->next = _free;
+                _free = slot;
+                throw;
+            }
+        }
+
+        void destroy(E* entry) noexcept {
+            entry->~E();
+            Slot* slot = reinterpret_cast<Slot*>(entry);
+            slot->next = _free;
+            _free = slot;
+        }
+
+        [[nodiscard]] std::size_t capacity() const noexcept { return _capacity; }
+
+        // whether the slabs of other may change hands with ours, i.e. the two allocators are interchangeable
+        [[nodiscard]] bool compatible(const EntryPool& other) const noexcept { return _alloc == other._alloc; }
+
+        // exchanges the slabs, and the entries living in them, with other; requires compatible(other)
+        void swap(EntryPool& other) noexcept {
+            assert(compatible(other));
+            _slabs.swap(other._slabs);
+            std::swap(_free, other._free);
+            std::swap(_capacity, other._capacity);
+        }
+
+        // moves the slabs of other, and the entries living in them, to this pool; requires compatible(other)
+        // takes time in the number of other's free slots, which join the front of the free list
+        void absorb(EntryPool& other) {
+            assert(compatible(other));
+            if (&other == this) { return; }
+            _slabs.insert(_slabs.end(), other._slabs.begin(), other._slabs.end());  // the only step that may throw
+            other._slabs.clear();
+            if (other._free) {
+                Slot* tail = other._free;
+                while (tail->next) { tail = tail->next; }
+                tail->next = _free;
+                _free = std::exchange(other._free, nullptr);
+            }
+            _capacity += std::exchange(other._capacity, 0);
+        }
+    };
+}
+
+namespace data_structures {
+    // the default ID extractor: a callable supplied at run time if any, otherwise a conversion of the payload
+    // it is type-erased; name a functor/lambda type as the IdOf parameter of a queue to have it inlined instead
+    template<typename T, typename ID>
+    struct DynamicIdOf {
         std::optional<std::function<ID(const T& payload)>> id_func;
 
-        ID convert(const T& payload) const {  // resolve ID converter
+        DynamicIdOf() = default;
+
+        template<typename F, std::enable_if_t<std::is_constructible_v<decltype(id_func), F>, bool> = true>
+        DynamicIdOf(F f): id_func{f} {}
+
+        ID operator()(const T& payload) const {  // resolve ID converter
             if (id_func) {
                 return id_func.value()(payload);
             } else {
@@ -57,54 +275,196 @@ namespace data_structures {
                 }
             }
         }
+    };
+
+    // a stateless ID extractor converting the payload itself; no copy at all if T=ID
+    template<typename T, typename ID>
+    struct ConvertId {
+        decltype(auto) operator()(const T& payload) const {
+            if constexpr(std::is_same_v<T, ID>) {
+                return (payload);
+            } else {
+                return static_cast<ID>(payload);
+            }
+        }
+    };
+
+    // index policies: how a queue maps IDs to its entries
+    // map_type takes an allocator of any value type and rebinds it
+    // heterogeneous: whether lookups by other ID types work, given transparent Hash and KeyEqual
+    struct NodeIndex {  // std::unordered_map; one node allocation per entry
+        template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc=std::allocator<V>>
+        using map_type = std::unordered_map<K, V, Hash, KeyEqual, detail::rebind_alloc_t<Alloc, std::pair<const K, V>>>;
+        static constexpr bool heterogeneous = detail::unordered_heterogeneous;  // from C++20 on
+    };
+    struct FlatIndex {  // FlatMap; open addressing in one array, usually one cache miss per lookup
+        template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc=std::allocator<V>>
+        using map_type = FlatMap<K, V, Hash, KeyEqual, Alloc>;
+        static constexpr bool heterogeneous = true;
+    };
+
+    // selects the bounded mode of EagerQueue: at most n entries
+    struct Capacity {
+        std::size_t n;
+    };
+
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            typename IdOf=DynamicIdOf<T, ID>>
+    class QueueBase {
+    protected:
+        IdOf id_of;
+
+        // may hand out a reference into payload, depending on IdOf
+        decltype(auto) convert(const T& payload) const { return id_of(payload); }
 
         QueueBase() = default;
 
-        template<typename F, std::enable_if_t<std::is_constructible_v<decltype(id_func), F>, bool> = true>
-        explicit QueueBase(F f): id_func{f} {}
+        template<typename F, std::enable_if_t<std::is_constructible_v<IdOf, F>, bool> = true>
+        explicit QueueBase(F f): id_of(std::move(f)) {}
     };
 }
 
 namespace data_structures {
-    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>>
-    class EagerQueue: public QueueBase<T, ID, Hash, KeyEqual> {
+    // Arity is the number of children per node; wider heaps are shallower and scan children in one cache line
+    // the entry whose Priority compares least under Compare is on top
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            std::size_t Arity=2, typename Priority=double, typename Compare=std::less<Priority>,
+            typename IdOf=DynamicIdOf<T, ID>, typename Index=NodeIndex, typename Allocator=std::allocator<T>>
+    class EagerQueue: public QueueBase<T, ID, Hash, KeyEqual, IdOf> {
+    static_assert(Arity >= 2, "a heap needs at least two children per node");
+    public:
+        using priority_type = Priority;
+        using entry_type = detail::EagerEntry<T, Priority>;
+        using pool_type = EntryPool<entry_type, detail::rebind_alloc_t<Allocator, entry_type>>;
+        using allocator_type = Allocator;
     private:
-        std::vector<detail::EagerEntry<T>*> _data;
+        Compare _cmp;
+        pool_type _own_pool;
+        pool_type* _pool{&_own_pool};  // either _own_pool or one supplied by the user
+        std::vector<entry_type*, detail::rebind_alloc_t<Allocator, entry_type*>> _data;
         using size_type = typename decltype(_data)::size_type;
-        std::unordered_map<ID, detail::EagerEntry<T>*, Hash, KeyEqual> _m;
+        // arithmetic priorities are also kept in _keys, parallel to _data, so that sifting compares a contiguous
+        // block of children without touching the entries; a full block of doubles is even compared in SIMD
+        static constexpr bool keys_inline = std::is_arithmetic_v<Priority>;
+        std::vector<Priority, detail::rebind_alloc_t<Allocator, Priority>> _keys;  // empty unless keys_inline
+        using index_type = typename Index::template map_type<ID, entry_type*, Hash, KeyEqual, Allocator>;
+        index_type _m;
+        size_type _capacity{std::numeric_limits<size_type>::max()};  // unbounded unless constructed with a Capacity
+        // remove, reschedule and contains also take any Key that transparent Hash and KeyEqual accept
+        template<typename Key>
+        using if_lookup = detail::enable_lookup_t<Key, ID, Hash, KeyEqual, detail::index_heterogeneous<Index>::value>;
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        QueueStats _stats;
+#endif
     private:
-        size_type left(size_type i) const { return 2*i+1; }
-        size_type right(size_type i) const { return 2*i+2; }
-        size_type parent(size_type i) const { return (i-1)/2; }  // UB when i==0
+        static size_type first_child(size_type i) { return Arity*i+1; }
+        static size_type parent(size_type i) { return (i-1)/Arity; }  // UB when i==0
+        [[nodiscard]] const Priority& key(size_type idx) const {
+            if constexpr(keys_inline) { return _keys[idx]; } else { return _data[idx]->time; }
+        }
+        template<bool TrackLoc=true>
+        void place(const size_type idx, entry_type* entry, const Priority& time) {
+            _data[idx] = entry;
+            if constexpr(keys_inline) { _keys[idx] = time; }
+            if constexpr(TrackLoc) { entry->loc = idx; }
+        }
+        void push_back(entry_type* entry) {
+            _data.push_back(entry);
+            if constexpr(keys_inline) {
+                try {
+                    _keys.push_back(entry->time);
+                } catch (...) {
+                    _data.pop_back();
+                    throw;
+                }
+            }
+        }
+        void pop_back() {
+            _data.pop_back();
+            if constexpr(keys_inline) { _keys.pop_back(); }
+        }
+        void sync_keys() {  // after _data was rearranged wholesale
+            if constexpr(keys_inline) {
+                _keys.resize(_data.size());
+                for (size_type i = 0; i < _data.size(); ++i) { _keys[i] = _data[i]->time; }
+            }
+        }
+        // the least of the children in [child, last), the first one on ties
+        [[nodiscard]] size_type min_child(const size_type child, const size_type last) const {
+            if constexpr(keys_inline && detail::has_simd_min_child<Arity, Priority, Compare>) {
+                if (last - child == Arity) {
+                    const size_type offset = detail::simd_min_child<Arity>(_keys.data() + child);
+                    if (offset < Arity) { return child + offset; }
+                }
+            }
+            size_type min_idx = child;
+            for (size_type c = child + 1; c < last; ++c) {
+                if (_cmp(key(c), key(min_idx))) { min_idx = c; }
+            }
+            return min_idx;
+        }
+        // both sifts move a hole instead of swapping, and write the moving entry only once at the end
+        template<bool TrackLoc=true>
         bool perc_down(const size_type idx) {  // return true if any perc-down actually happens
-            size_type min_idx = idx;
-            const size_type left_idx = left(idx);
-            const size_type right_idx = right(idx);
-            if (left_idx < _data.size() && _data[left_idx]->time < _data[min_idx]->time) {
-                min_idx = left_idx;
-            }
-            if (right_idx < _data.size() && _data[right_idx]->time < _data[min_idx]->time) {
-                min_idx = right_idx;
-            }
-            if (min_idx == idx) {  // heap property intact on idx; no pd needed
-                return false;
-            } else {  // swap and update loc
-                std::swap(_data[idx], _data[min_idx]);
-                _data[min_idx]->loc = min_idx;
-                _data[idx]->loc = idx;
-                perc_down(min_idx);
-                return true;
+            entry_type* moving = _data[idx];
+            const std::conditional_t<keys_inline, Priority, const Priority&> time = key(idx);
+            const size_type n = _data.size();
+            size_type hole = idx;
+            for (size_type child = first_child(hole); child < n; child = first_child(hole)) {
+                const size_type min_idx = min_child(child, std::min(child + Arity, n));
+                if (!_cmp(key(min_idx), time)) { break; }  // heap property intact
+                place<TrackLoc>(hole, _data[min_idx], key(min_idx));
+                GSK_STAT(++_stats.sift_moves);
+                hole = min_idx;
             }
+            if (hole == idx) { return false; }
+            place<TrackLoc>(hole, moving, time);
+            return true;
         }
         void perc_up(const size_type idx) {
-            if (idx == 0) { return; }
-            const size_type parent_idx = parent(idx);
-            if (_data[idx]->time < _data[parent_idx]->time) {
-                std::swap(_data[idx], _data[parent_idx]);
-                _data[idx]->loc = idx;
-                _data[parent_idx]->loc = parent_idx;
-                perc_up(parent_idx);
+            entry_type* moving = _data[idx];
+            const std::conditional_t<keys_inline, Priority, const Priority&> time = key(idx);
+            size_type hole = idx;
+            while (hole > 0) {
+                const size_type parent_idx = parent(hole);
+                if (!_cmp(time, key(parent_idx))) { break; }
+                place(hole, _data[parent_idx], key(parent_idx));
+                GSK_STAT(++_stats.sift_moves);
+                hole = parent_idx;
+            }
+            if (hole != idx) { place(hole, moving, time); }
+        }
+        // Floyd's bottom-up heap construction in O(n); locs are fixed up in a single pass afterwards
+        void heapify() {
+            for (size_type i = _data.size() < 2 ? 0 : parent(_data.size() - 1) + 1; i-- > 0;) {
+                perc_down<false>(i);
             }
+            for (size_type i = 0; i < _data.size(); ++i) {
+                _data[i]->loc = i;
+            }
+        }
+        entry_type* take_top() {  // detaches the top entry from the heap; requires a non-empty queue
+            auto* top = _data[0];
+            if (_data.size() > 1) { place(0, _data.back(), key(_data.size() - 1)); }
+            pop_back();
+            if (!_data.empty()) { perc_down(0); }
+            return top;
+        }
+        void unmap(const entry_type* entry) {
+            auto it = _m.find(this->convert(entry->payload));  // the ID is resolved only once
+            assert(it!=_m.end());
+            _m.erase(it);
+        }
+        // takes an entry the index no longer refers to out of the heap and frees it
+        void detach(entry_type* removed_entry) {
+            assert(_data.size());
+            GSK_STAT(++_stats.removes);
+            auto loc = removed_entry->loc;
+            _pool->destroy(removed_entry);
+            if (loc==_data.size()-1) { pop_back(); return; }  // will seg-fault at _data[loc]->loc otherwise
+            place(loc, _data.back(), key(_data.size() - 1));
+            pop_back();
+            fix(loc);
         }
         // the same functionality as heap.Fix in Golang
         // restores heap property after ONE change of priority/time at idx
@@ -113,180 +473,1287 @@ namespace data_structures {
                 perc_up(idx);
             }
         }
+        // restores the heap after entries were appended from old_size on, the way push_range does
+        void restore(const size_type old_size) {
+            if (_data.size() - old_size >= old_size) {
+                heapify();
+            } else {
+                for (size_type i = old_size; i < _data.size(); ++i) {
+                    _data[i]->loc = i;
+                    perc_up(i);
+                }
+            }
+        }
+        // whether the entries of other can join this queue as they are, without being rebuilt in _pool
+        [[nodiscard]] bool can_adopt(const EagerQueue& other) const noexcept {
+            return _pool == other._pool || (other._pool == &other._own_pool && _pool->compatible(other._own_pool));
+        }
+        // a full bounded queue admits time in place of its top, in a single sift; the new entry is built and
+        // indexed before the top goes, so nothing changes if that throws
+        template<typename ...Arg>
+        void replace_top(Priority time, Arg&&... args) {
+            auto* entry = _pool->create(0, std::move(time), std::forward<Arg>(args)...);
+            ID id = this->convert(entry->payload);
+            assert(!_m.count(id));
+            try {
+                _m.emplace(std::move(id), entry);
+            } catch (...) {
+                _pool->destroy(entry);
+                throw;
+            }
+            entry_type* top = _data[0];
+            unmap(top);
+            place(0, entry, entry->time);
+            _pool->destroy(top);
+            GSK_STAT(++_stats.pushes);
+            GSK_STAT(++_stats.evictions);
+            perc_down(0);
+        }
+        void trim() {  // drops tops until a bounded queue fits again
+            while (_data.size() > _capacity) {
+                entry_type* top = take_top();
+                unmap(top);
+                _pool->destroy(top);
+                GSK_STAT(++_stats.evictions);
+            }
+        }
+        void release(EagerQueue& other) noexcept {  // empties other once its entries have changed hands
+            other._data.clear();
+            other._keys.clear();
+            other._m.clear();
+        }
 
     public:
         EagerQueue() = default;
 
-        EagerQueue(const EagerQueue<T>& other) = delete;
-        EagerQueue(EagerQueue<T>&& other) = delete;
-        EagerQueue& operator=(const EagerQueue<T> & other) = delete;
-        EagerQueue& operator=(EagerQueue<T> && other) = delete;
+        EagerQueue(const EagerQueue& other) = delete;
+        EagerQueue& operator=(const EagerQueue& other) = delete;
 
-        ~EagerQueue() {
-            for (auto* entry: _data) {
-                delete entry;
+        // the heap, the index and the entries change hands without being copied; other is left empty
+        // entries in a pool supplied by the user stay there, so it must outlive this queue instead
+        EagerQueue(EagerQueue&& other) noexcept(std::is_nothrow_move_constructible_v<index_type>):
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>(std::move(other)), _cmp(std::move(other._cmp)),
+            _own_pool(std::move(other._own_pool)), _pool(other._pool == &other._own_pool ? &_own_pool : other._pool),
+            _data(std::move(other._data)), _keys(std::move(other._keys)), _m(std::move(other._m)),
+            _capacity(other._capacity) {
+            GSK_STAT(_stats = other._stats);
+            release(other);
+        }
+        // the same, unless other's own pool allocates differently from this one's (as std::pmr may):
+        // then the entries are rebuilt one by one in this queue's pool, as with merge
+        EagerQueue& operator=(EagerQueue&& other) {
+            if (this == &other) { return *this; }
+            clear();
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>::operator=(std::move(other));
+            _cmp = std::move(other._cmp);
+            _capacity = other._capacity;
+            GSK_STAT(_stats = other._stats);
+            if (other._pool != &other._own_pool || _own_pool.compatible(other._own_pool)) {
+                if (other._pool == &other._own_pool) {
+                    _own_pool.swap(other._own_pool);
+                    _pool = &_own_pool;
+                } else {
+                    _pool = other._pool;
+                }
+                _data = std::move(other._data);
+                _keys = std::move(other._keys);
+                _m = std::move(other._m);
+                release(other);
+            } else {
+                merge(other);
             }
+            return *this;
         }
 
+        ~EagerQueue() { clear(); }
+
+        template<typename F, std::enable_if_t<!std::is_convertible_v<F, Allocator>, bool> = true>
+        explicit EagerQueue(F f): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {}
+
+        // the heap, the index and the entries all allocate from alloc
+        explicit EagerQueue(const Allocator& alloc): _own_pool{alloc}, _data(alloc), _keys(alloc), _m(alloc) {}
         template<typename F>
-        explicit EagerQueue(F f): QueueBase<T, ID, Hash, KeyEqual>{f} {}
+        EagerQueue(F f, const Allocator& alloc):
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _own_pool{alloc}, _data(alloc), _keys(alloc), _m(alloc) {}
 
+        // a bounded queue of at most capacity.n entries, for keeping the top k of a stream: it keeps the entries
+        // that compare greatest, i.e. those popped last; a push into a full queue either replaces the top, or compares
+        // no greater than it and is turned away in O(1), building nothing. the storage is all allocated up front
+        // (one spare entry for replacements), so after that the queue allocates only when a NodeIndex adds a node
+        explicit EagerQueue(Capacity capacity): _capacity{capacity.n} {
+            assert(capacity.n > 0);
+            reserve(capacity.n + 1);
+        }
+        template<typename F>
+        EagerQueue(F f, Capacity capacity): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _capacity{capacity.n} {
+            assert(capacity.n > 0);
+            reserve(capacity.n + 1);
+        }
+        EagerQueue(Capacity capacity, const Allocator& alloc):
+            _own_pool{alloc}, _data(alloc), _keys(alloc), _m(alloc), _capacity{capacity.n} {
+            assert(capacity.n > 0);
+            reserve(capacity.n + 1);
+        }
+
+        // entries are drawn from (and returned to) pool, which must outlive the queue
+        explicit EagerQueue(pool_type& pool): _pool{&pool} {}
+        template<typename F>
+        EagerQueue(F f, pool_type& pool): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _pool{&pool} {}
+
+        template<typename F>
+        EagerQueue(F f, const std::vector<std::pair<Priority, T>>& data): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {
+            push_range(data.begin(), data.end());
+        }
+
+        explicit EagerQueue(const std::vector<std::pair<Priority, T>>& data) {
+            push_range(data.begin(), data.end());
+        }
+
+        // inserts every (time, payload) pair in [first, last)
+        // heapifies in linear time when the range is at least as large as the queue; sifts each entry up otherwise
+        template<typename It>
+        void push_range(It first, It last) {
+            if (_capacity != std::numeric_limits<size_type>::max()) {  // bounded: each one may be turned away
+                for (; first != last; ++first) {
+                    auto&& item = *first;
+                    push(item.first, std::forward<decltype(item)>(item).second);
+                }
+                return;
+            }
+            const size_type old_size = _data.size();
+            if constexpr(std::is_base_of_v<std::forward_iterator_tag,
+                                           typename std::iterator_traits<It>::iterator_category>) {
+                const auto total = old_size + static_cast<size_type>(std::distance(first, last));
+                reserve(total);
+            }
+            for (; first != last; ++first) {
+                auto&& item = *first;  // moves payloads out of a range of std::move_iterator
+                auto* entry = _pool->create(_data.size(), item.first, std::forward<decltype(item)>(item).second);
+                ID id = this->convert(entry->payload);
+                assert(!_m.count(id));
+                push_back(entry);
+                _m.emplace(std::move(id), entry);
+            }
+            GSK_STAT(_stats.pushes += _data.size() - old_size);
+            restore(old_size);
+        }
+
+        // moves every entry of other into this queue and leaves other empty; no ID may be queued in both
+        // the entries change hands as they are when both queues share a pool, or when other has its own pool
+        // and it allocates like this queue's; otherwise each payload is moved into an entry of this queue's pool
+        // the heaps are combined like push_range does: heapifying all n + m entries when m >= n,
+        // sifting the m newcomers up otherwise; a bounded queue then drops tops until it fits
+        void merge(EagerQueue& other) {
+            if (this == &other || other._data.empty()) { return; }
+            const size_type old_size = _data.size();
+            _data.reserve(old_size + other._data.size());
+            if constexpr(keys_inline) { _keys.reserve(old_size + other._data.size()); }
+            _m.reserve(old_size + other._data.size());
+            if (can_adopt(other)) {
+                if (_pool != other._pool) { _pool->absorb(other._own_pool); }
+                for (entry_type* entry: other._data) {
+                    ID id = this->convert(entry->payload);
+                    assert(!_m.count(id));
+                    push_back(entry);
+                    _m.emplace(std::move(id), entry);
+                }
+                release(other);
+            } else {
+                try {
+                    while (!other._data.empty()) {  // the last entry of a heap leaves the rest a heap
+                        entry_type* moved = other._data.back();
+                        auto it = other._m.find(other.convert(moved->payload));  // before the payload moves
+                        auto* entry = _pool->create(_data.size(), moved->time, std::move(moved->payload));
+                        ID id = this->convert(entry->payload);
+                        assert(!_m.count(id));
+                        push_back(entry);
+                        _m.emplace(std::move(id), entry);
+                        other._m.erase(it);
+                        other.pop_back();
+                        other._pool->destroy(moved);
+                    }
+                } catch (...) {
+                    restore(old_size);
+                    trim();
+                    throw;
+                }
+            }
+            restore(old_size);
+            trim();
+        }
+
+        // destroys every entry
+        void clear() noexcept {
+            for (auto* entry: _data) {
+                _pool->destroy(entry);
+            }
+            _data.clear();
+            _keys.clear();
+            _m.clear();
+        }
+
+        // false only when a full bounded queue turns the entry away
         template<typename ...Arg>
-        void push(double time, Arg&&... args) {
-            auto* entry = new detail::EagerEntry<T>(_data.size(), time, std::forward<Arg>(args)...);
+        bool push(Priority time, Arg&&... args) {
+            if (_data.size() >= _capacity) {
+                if (!_cmp(key(0), time)) {
+                    GSK_STAT(++_stats.rejections);
+                    return false;
+                }
+                replace_top(std::move(time), std::forward<Arg>(args)...);
+                return true;
+            }
+            auto* entry = _pool->create(_data.size(), time, std::forward<Arg>(args)...);
             ID id = this->convert(entry->payload);
             assert(!_m.count(id));
-            _data.push_back(entry);
+            push_back(entry);
             _m.emplace(std::move(id), entry);
+            GSK_STAT(++_stats.pushes);
             perc_up(_data.size()-1);
+            return true;
         }
 
-        std::pair<double, T> pop() {
+        std::pair<Priority, T> pop() {
             if (_data.empty()) {
                 throw std::runtime_error("Empty Queue");
             }
-            auto* top = _data[0];
-            _data[0] = _data.back();
-            _data.pop_back();
-            _data[0]->loc = 0;
-            perc_down(0);
-            detail::EagerEntry<T> top_copy = std::move(*top);
-            delete top;
-            assert(_m.count(this->convert(top_copy.payload)));
-            _m.erase(this->convert(top_copy.payload));
-            return { top_copy.time, std::move(top_copy.payload) };
+            auto* top = take_top();
+            unmap(top);
+            GSK_STAT(++_stats.pops);
+            std::pair<Priority, T> result{ top->time, std::move(top->payload) };  // move the payload out
+            _pool->destroy(top);  // and then recycle
+            return result;
+        }
+
+        // pops every entry due by time (i.e. not after it) in priority order, moving each into sink:
+        // either a callable taking (Priority, T&&) or an output iterator of std::pair<Priority, T>
+        // a large batch is cut out of the heap at once and the rest re-heapified in O(n)
+        // returns the number of entries popped
+        template<typename Sink>
+        size_type pop_until(const Priority& time, Sink sink) {
+            auto due = [&](const entry_type* e) { return !_cmp(time, e->time); };
+            const size_type k = detail::count_due<Arity>(_data, due);
+            if (k * detail::bit_width(_data.size()) < _data.size()) {  // cheaper to sift k times
+                return pop_n(k, std::move(sink));
+            }
+            auto mid = std::partition(_data.begin(), _data.end(), [&](const entry_type* e) { return !due(e); });
+            decltype(_data) batch(mid, _data.end(), _data.get_allocator());
+            _data.erase(mid, _data.end());
+            sync_keys();
+            heapify();
+            std::sort(batch.begin(), batch.end(),
+                      [this](const entry_type* e1, const entry_type* e2) { return _cmp(e1->time, e2->time); });
+            for (const entry_type* entry: batch) {
+                unmap(entry);
+            }
+            GSK_STAT(_stats.pops += k);
+            detail::deliver(batch.begin(), batch.end(), *_pool, sink);
+            return k;
         }
 
-        std::pair<double, const T&> peek() const {
+        // moves every entry into sink in no particular order, leaving the queue empty, in O(n); see pop_until
+        template<typename Sink>
+        size_type extract_all(Sink sink) {
+            decltype(_data) all(std::move(_data));
+            _data.clear();
+            _keys.clear();
+            _m.clear();
+            GSK_STAT(_stats.pops += all.size());
+            detail::deliver(all.begin(), all.end(), *_pool, sink);
+            return all.size();
+        }
+
+        // pops the first (at most) n entries in priority order into sink; see pop_until
+        template<typename Sink>
+        size_type pop_n(size_type n, Sink sink) {
+            n = std::min(n, _data.size());
+            for (size_type i = 0; i < n; ++i) {
+                entry_type* top = take_top();
+                unmap(top);
+                GSK_STAT(++_stats.pops);
+                detail::deliver(&top, &top + 1, *_pool, sink);
+            }
+            return n;
+        }
+
+        std::pair<Priority, const T&> peek() const {
             auto* entry = _data[0];
             return { entry->time, entry->payload };
         }
 
-        void remove(const ID& id) {
+        // the time and payload queued under id; throws std::out_of_range if there is none
+        // the payload may be changed in place as long as its ID stays the same
+        std::pair<Priority, T&> at(const ID& id) { return at<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        std::pair<Priority, T&> at(const Key& id) {
+            auto it = _m.find(id);
+            if (it == _m.end()) { throw std::out_of_range("ID not found"); }
+            return { it->second->time, it->second->payload };
+        }
+        std::pair<Priority, const T&> at(const ID& id) const { return at<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        std::pair<Priority, const T&> at(const Key& id) const {
+            auto it = _m.find(id);
+            if (it == _m.end()) { throw std::out_of_range("ID not found"); }
+            return { it->second->time, it->second->payload };
+        }
+
+        // the entry queued under id, or nullptr; it stays put until it leaves the queue, so a caller may look it up
+        // once and then read it, change its payload (but not its ID) in place, and reschedule it without a lookup
+        entry_type* find(const ID& id) { return find<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        entry_type* find(const Key& id) {
+            auto it = _m.find(id);
+            return it == _m.end() ? nullptr : it->second;
+        }
+        const entry_type* find(const ID& id) const { return find<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        const entry_type* find(const Key& id) const {
+            auto it = _m.find(id);
+            return it == _m.end() ? nullptr : it->second;
+        }
+
+        void remove(const ID& id) { remove<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        void remove(const Key& id) {
             auto it = _m.find(id);
             assert(it!=_m.end());
-            assert(_data.size());
             auto* removed_entry = it->second;
             _m.erase(it);
-            auto loc = removed_entry->loc;
-            delete removed_entry;
-            if (loc==_data.size()-1) { _data.pop_back(); return; }  // will seg-fault at _data[loc]->loc otherwise
-            _data[loc] = _data.back();
-            _data.pop_back();
-            _data[loc]->loc = loc;
-            fix(loc);
+            detach(removed_entry);
+        }
+        // the entry must come from find on this queue; the index drops it by the ID in its payload
+        void remove(entry_type* entry) {
+            assert(entry && entry->loc < _data.size() && _data[entry->loc] == entry);
+            unmap(entry);
+            detach(entry);
         }
 
-        void reschedule(const ID& id, double new_time) {
+        void reschedule(const ID& id, Priority new_time) { reschedule<ID>(id, new_time); }
+        template<typename Key, if_lookup<Key> = 0>
+        void reschedule(const Key& id, Priority new_time) {
             auto it = _m.find(id);
             assert(it!=_m.end());
-            it->second->time = new_time;
-            fix(it->second->loc);
+            reschedule(it->second, std::move(new_time));
+        }
+        // the entry must come from find on this queue
+        void reschedule(entry_type* entry, Priority new_time) {
+            assert(entry && entry->loc < _data.size() && _data[entry->loc] == entry);
+            entry->time = new_time;
+            if constexpr(keys_inline) { _keys[entry->loc] = new_time; }
+            GSK_STAT(++_stats.reschedules);
+            fix(entry->loc);
         }
 
-        [[nodiscard]] bool contains(const ID& id) const {
+        [[nodiscard]] bool contains(const ID& id) const { return contains<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        [[nodiscard]] bool contains(const Key& id) const {
             return _m.find(id) != _m.end();
         }
 
+        // makes room for n entries in the heap, the index and the pool
+        void reserve(size_type n) {
+            _data.reserve(n);
+            if constexpr(keys_inline) { _keys.reserve(n); }
+            _m.reserve(n);
+            _pool->reserve(n);
+        }
+
         [[nodiscard]] auto size() const noexcept { return _data.size(); }
+        // the bound of a bounded queue; the largest size_type otherwise
+        [[nodiscard]] size_type capacity() const noexcept { return _capacity; }
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(_data.get_allocator()); }
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        // the counters, plus the current shape of the heap and of the index
+        [[nodiscard]] QueueStats stats() const {
+            QueueStats snapshot = _stats;
+            snapshot.size = size();
+            snapshot.heap_size = _data.size();
+            snapshot.heap_capacity = _data.capacity();
+            snapshot.index = detail::probe_stats(_m);
+            return snapshot;
+        }
+        void reset_stats() noexcept { _stats = {}; }
+#endif
 
     };
 }
 
 namespace data_structures {
-    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>>
-    class LazyQueue: public QueueBase<T, ID, Hash, KeyEqual> {
+    // the entry whose Priority compares least under Compare is on top
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            typename Priority=double, typename Compare=std::less<Priority>, typename IdOf=DynamicIdOf<T, ID>,
+            typename Index=NodeIndex, typename Allocator=std::allocator<T>>
+    class LazyQueue: public QueueBase<T, ID, Hash, KeyEqual, IdOf> {
+    public:
+        using priority_type = Priority;
+        using entry_type = detail::LazyEntry<T, Priority>;
+        using pool_type = EntryPool<entry_type, detail::rebind_alloc_t<Allocator, entry_type>>;
+        using allocator_type = Allocator;
     private:
-        std::vector<detail::LazyEntry<T>*> _data;
+        detail::EntryCompare<Compare> _cmp;
+        pool_type _own_pool;
+        pool_type* _pool{&_own_pool};  // either _own_pool or one supplied by the user
+        std::vector<entry_type*, detail::rebind_alloc_t<Allocator, entry_type*>> _data;
         using size_type = typename decltype(_data)::size_type;
         size_type _size{};
-        std::unordered_map<ID, detail::LazyEntry<T>*, Hash, KeyEqual> _m;
-    public:
-        LazyQueue() = default;
-
-        template<typename F>
-        explicit LazyQueue(F f): QueueBase<T, ID, Hash, KeyEqual>{f} {}
-
-        template<typename F>
-        LazyQueue(F f, const std::vector<std::pair<double, T>>& data): QueueBase<T, ID, Hash, KeyEqual>{f} {
+        using index_type = typename Index::template map_type<ID, entry_type*, Hash, KeyEqual, Allocator>;
+        index_type _m;
+        // remove, reschedule and contains also take any Key that transparent Hash and KeyEqual accept
+        template<typename Key>
+        using if_lookup = detail::enable_lookup_t<Key, ID, Hash, KeyEqual, detail::index_heterogeneous<Index>::value>;
+        double _max_tombstone_ratio{0.5};
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        QueueStats _stats;
+#endif
+        static constexpr size_type min_compaction_size = 64;  // not worth rebuilding tiny heaps
+    private:
+        void assign(const std::vector<std::pair<Priority, T>>& data) {
             _size = data.size();
+            _data.reserve(data.size());
+            _pool->reserve(data.size());
             for (const auto& [time, payload]: data) {
                 ID id = this->convert(payload);
                 assert(!_m.count(id));
-                auto * entry = new detail::LazyEntry<T>(time, payload);
+                auto * entry = _pool->create(time, payload);
                 _data.push_back(entry);
                 _m.emplace(std::move(id), entry);
             }
-            std::make_heap(_data.begin(), _data.end(), detail::compare<T>);
+            GSK_STAT(_stats.pushes += data.size());
+            std::make_heap(_data.begin(), _data.end(), _cmp);
+        }
+        void unmap(const entry_type* entry) {
+            auto it = _m.find(this->convert(entry->payload));  // the ID is resolved only once
+            assert(it!=_m.end());
+            _m.erase(it);
+        }
+        // restores the heap after entries were appended from old_size on
+        void restore(const size_type old_size) {
+            if (_data.size() - old_size >= old_size) {
+                std::make_heap(_data.begin(), _data.end(), _cmp);
+            } else {
+                for (auto it = _data.begin() + static_cast<std::ptrdiff_t>(old_size); it != _data.end(); ++it) {
+                    std::push_heap(_data.begin(), it + 1, _cmp);
+                }
+            }
+        }
+        // whether the entries of other can join this queue as they are; see EagerQueue
+        [[nodiscard]] bool can_adopt(const LazyQueue& other) const noexcept {
+            return _pool == other._pool || (other._pool == &other._own_pool && _pool->compatible(other._own_pool));
+        }
+        void release(LazyQueue& other) noexcept {  // empties other once its entries have changed hands
+            other._data.clear();
+            other._m.clear();
+            other._size = 0;
+        }
+        // rebuilds the heap once dead entries make up more than _max_tombstone_ratio of _data
+        void maybe_compact() {
+            const size_type tombstones = _data.size() - _size;
+            if (tombstones >= min_compaction_size
+                && static_cast<double>(tombstones) > _max_tombstone_ratio * static_cast<double>(_data.size())) {
+                compact();
+            }
         }
+    public:
+        LazyQueue() = default;
+
+        template<typename F, std::enable_if_t<!std::is_convertible_v<F, Allocator>, bool> = true>
+        explicit LazyQueue(F f): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {}
+
+        // the heap, the index and the entries all allocate from alloc
+        explicit LazyQueue(const Allocator& alloc): _own_pool{alloc}, _data(alloc), _m(alloc) {}
+        template<typename F>
+        LazyQueue(F f, const Allocator& alloc):
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _own_pool{alloc}, _data(alloc), _m(alloc) {}
+
+        // entries are drawn from (and returned to) pool, which must outlive the queue
+        explicit LazyQueue(pool_type& pool): _pool{&pool} {}
+        template<typename F>
+        LazyQueue(F f, pool_type& pool): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _pool{&pool} {}
+
+        template<typename F>
+        LazyQueue(F f, const std::vector<std::pair<Priority, T>>& data): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {
+            assign(data);
+        }
+
+        explicit LazyQueue(const std::vector<std::pair<Priority, T>>& data) { assign(data); }
+
+        ~LazyQueue() { clear(); }
+
+        LazyQueue(const LazyQueue& other) = delete;
+        LazyQueue& operator=(const LazyQueue& other) = delete;
 
-        explicit LazyQueue(const std::vector<std::pair<double, T>>& data): LazyQueue(std::nullopt, data) {}
+        // the heap, the index and the entries change hands without being copied; see EagerQueue
+        LazyQueue(LazyQueue&& other) noexcept(std::is_nothrow_move_constructible_v<index_type>):
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>(std::move(other)), _cmp(std::move(other._cmp)),
+            _own_pool(std::move(other._own_pool)), _pool(other._pool == &other._own_pool ? &_own_pool : other._pool),
+            _data(std::move(other._data)), _size(other._size), _m(std::move(other._m)),
+            _max_tombstone_ratio(other._max_tombstone_ratio) {
+            GSK_STAT(_stats = other._stats);
+            release(other);
+        }
+        LazyQueue& operator=(LazyQueue&& other) {
+            if (this == &other) { return *this; }
+            clear();
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>::operator=(std::move(other));
+            _cmp = std::move(other._cmp);
+            _max_tombstone_ratio = other._max_tombstone_ratio;
+            GSK_STAT(_stats = other._stats);
+            if (other._pool != &other._own_pool || _own_pool.compatible(other._own_pool)) {
+                if (other._pool == &other._own_pool) {
+                    _own_pool.swap(other._own_pool);
+                    _pool = &_own_pool;
+                } else {
+                    _pool = other._pool;
+                }
+                _data = std::move(other._data);
+                _m = std::move(other._m);
+                _size = other._size;
+                release(other);
+            } else {
+                merge(other);
+            }
+            return *this;
+        }
 
-        ~LazyQueue() {
-            for (detail::LazyEntry<T>* e : _data) {
-                delete e;
-            }  // don't need to delete for map
+        // moves every live entry of other into this queue and leaves other empty; no ID may be queued in both
+        // entries change hands as EagerQueue::merge describes, other's tombstones are dropped on the way,
+        // and the heaps are combined by make_heap on all entries when m >= n, by m push_heaps otherwise
+        void merge(LazyQueue& other) {
+            if (this == &other || other._data.empty()) { return; }
+            const size_type old_size = _data.size();
+            _data.reserve(old_size + other._size);
+            _m.reserve(_size + other._size);
+            if (can_adopt(other)) {
+                if (_pool != other._pool) { _pool->absorb(other._own_pool); }
+                for (entry_type* entry: other._data) {
+                    if (!entry->exist) {
+                        _pool->destroy(entry);
+                        continue;
+                    }
+                    ID id = this->convert(entry->payload);
+                    assert(!_m.count(id));
+                    _data.push_back(entry);
+                    _m.emplace(std::move(id), entry);
+                }
+                _size += other._size;
+                release(other);
+            } else {
+                try {
+                    while (!other._data.empty()) {  // the last entry of a heap leaves the rest a heap
+                        entry_type* moved = other._data.back();
+                        if (moved->exist) {
+                            auto it = other._m.find(other.convert(moved->payload));  // before the payload moves
+                            auto* entry = _pool->create(moved->time, std::move(moved->payload));
+                            ID id = this->convert(entry->payload);
+                            assert(!_m.count(id));
+                            _data.push_back(entry);
+                            _m.emplace(std::move(id), entry);
+                            ++_size;
+                            other._m.erase(it);
+                            --other._size;
+                        }
+                        other._data.pop_back();
+                        other._pool->destroy(moved);
+                    }
+                } catch (...) {
+                    restore(old_size);
+                    throw;
+                }
+            }
+            restore(old_size);
+        }
+
+        // destroys every entry, tombstones included
+        void clear() noexcept {
+            for (entry_type* entry: _data) {
+                _pool->destroy(entry);
+            }  // the index holds only pointers
+            _data.clear();
+            _m.clear();
+            _size = 0;
         }
 
-        LazyQueue(const LazyQueue<T>& other) = delete;
-        LazyQueue(LazyQueue<T>&& other) = delete;
-        LazyQueue& operator=(const LazyQueue<T> & other) = delete;
-        LazyQueue& operator=(LazyQueue<T> && other) = delete;
 
+        // inserts every (time, payload) pair in [first, last)
+        // rebuilds the heap in linear time when the range is at least as large as the heap; pushes each entry otherwise
+        template<typename It>
+        void push_range(It first, It last) {
+            const size_type old_size = _data.size();
+            if constexpr(std::is_base_of_v<std::forward_iterator_tag,
+                                           typename std::iterator_traits<It>::iterator_category>) {
+                const auto n = static_cast<size_type>(std::distance(first, last));
+                _data.reserve(old_size + n);
+                _m.reserve(_size + n);
+                _pool->reserve(_size + n);
+            }
+            for (; first != last; ++first) {
+                auto&& item = *first;  // moves payloads out of a range of std::move_iterator
+                auto* entry = _pool->create(item.first, std::forward<decltype(item)>(item).second);
+                ID id = this->convert(entry->payload);
+                assert(!_m.count(id));
+                _data.push_back(entry);
+                _m.emplace(std::move(id), entry);
+                ++_size;
+            }
+            GSK_STAT(_stats.pushes += _data.size() - old_size);
+            restore(old_size);
+        }
 
         template<typename ...Arg>
-        void push(double time, Arg&&... args) {
-            auto* entry = new detail::LazyEntry<T>(time, std::forward<Arg>(args)...);
+        void push(Priority time, Arg&&... args) {
+            auto* entry = _pool->create(time, std::forward<Arg>(args)...);
             ID id = this->convert(entry->payload);
             assert(!_m.count(id));
             ++_size;
             _data.push_back(entry);
             _m.emplace(std::move(id), entry);
-            std::push_heap(_data.begin(), _data.end(), detail::compare<T>);
+            GSK_STAT(++_stats.pushes);
+            std::push_heap(_data.begin(), _data.end(), _cmp);
         }
 
-        std::pair<double, T> pop() {
+        std::pair<Priority, T> pop() {
             while (_size > 0) {
-                std::pop_heap(_data.begin(), _data.end(), detail::compare<T>);
-                detail::LazyEntry<T>* entry = _data.back();
+                std::pop_heap(_data.begin(), _data.end(), _cmp);
+                entry_type* entry = _data.back();
                 _data.pop_back();
-                detail::LazyEntry<T> entry_copy = std::move(*entry); // move the content of entry out
-                delete entry;  // and then delete
-                if (entry_copy.exist) {
+                if (entry->exist) {
                     _size--;
-                    assert(_m.count(this->convert(entry_copy.payload)));
-                    _m.erase(this->convert(entry_copy.payload));
-                    return { entry_copy.time, std::move(entry_copy.payload) };
+                    unmap(entry);
+                    GSK_STAT(++_stats.pops);
+                    std::pair<Priority, T> result{ entry->time, std::move(entry->payload) };  // move the payload out
+                    _pool->destroy(entry);  // and then recycle
+                    return result;
                 }
+                GSK_STAT(++_stats.tombstones_skipped);
+                _pool->destroy(entry);
             }
             throw std::runtime_error("Empty Queue");
         }
 
-        std::pair<double, const T&> peek() {
+        // pops every entry due by time (i.e. not after it) in priority order, moving each into sink:
+        // either a callable taking (Priority, T&&) or an output iterator of std::pair<Priority, T>
+        // a large batch, tombstones included, is cut out of the heap at once and the rest re-heapified in O(n)
+        // returns the number of entries popped
+        template<typename Sink>
+        size_type pop_until(const Priority& time, Sink sink) {
+            auto due = [&](const entry_type* e) { return !_cmp.cmp(time, e->time); };
+            const size_type k = detail::count_due<2>(_data, due);  // the heaps of <algorithm> are binary
+            if (k * detail::bit_width(_data.size()) < _data.size()) {  // cheaper to sift k times
+                size_type popped = 0;
+                while (!_data.empty() && due(_data[0])) {
+                    std::pop_heap(_data.begin(), _data.end(), _cmp);
+                    entry_type* entry = _data.back();
+                    _data.pop_back();
+                    if (entry->exist) {
+                        _size--;
+                        ++popped;
+                        unmap(entry);
+                        GSK_STAT(++_stats.pops);
+                        detail::deliver(&entry, &entry + 1, *_pool, sink);
+                    } else {
+                        GSK_STAT(++_stats.tombstones_skipped);
+                        _pool->destroy(entry);
+                    }
+                }
+                return popped;
+            }
+            auto mid = std::partition(_data.begin(), _data.end(), [&](const entry_type* e) { return !due(e); });
+            decltype(_data) batch(mid, _data.end(), _data.get_allocator());
+            _data.erase(mid, _data.end());
+            std::make_heap(_data.begin(), _data.end(), _cmp);
+            auto live_end = std::partition(batch.begin(), batch.end(), [](const entry_type* e) { return e->exist; });
+            for (auto it = live_end; it != batch.end(); ++it) {
+                _pool->destroy(*it);
+            }
+            GSK_STAT(_stats.tombstones_skipped += static_cast<std::uint64_t>(batch.end() - live_end));
+            batch.erase(live_end, batch.end());
+            std::sort(batch.begin(), batch.end(),
+                      [this](const entry_type* e1, const entry_type* e2) { return _cmp.cmp(e1->time, e2->time); });
+            for (const entry_type* entry: batch) {
+                unmap(entry);
+            }
+            _size -= batch.size();
+            GSK_STAT(_stats.pops += batch.size());
+            detail::deliver(batch.begin(), batch.end(), *_pool, sink);
+            return batch.size();
+        }
+
+        // moves every live entry into sink in no particular order, leaving the queue empty, in O(n); see pop_until
+        template<typename Sink>
+        size_type extract_all(Sink sink) {
+            auto dead = std::partition(_data.begin(), _data.end(), [](const entry_type* e) { return e->exist; });
+            for (auto it = dead; it != _data.end(); ++it) {
+                _pool->destroy(*it);
+            }
+            GSK_STAT(_stats.tombstones_skipped += static_cast<std::uint64_t>(_data.end() - dead));
+            _data.erase(dead, _data.end());
+            decltype(_data) all(std::move(_data));
+            _data.clear();
+            _m.clear();
+            _size = 0;
+            GSK_STAT(_stats.pops += all.size());
+            detail::deliver(all.begin(), all.end(), *_pool, sink);
+            return all.size();
+        }
+
+        // pops the first (at most) n live entries in priority order into sink; see pop_until
+        template<typename Sink>
+        size_type pop_n(size_type n, Sink sink) {
+            size_type popped = 0;
+            while (popped < n && _size > 0) {
+                std::pop_heap(_data.begin(), _data.end(), _cmp);
+                entry_type* entry = _data.back();
+                _data.pop_back();
+                if (entry->exist) {
+                    _size--;
+                    ++popped;
+                    unmap(entry);
+                    GSK_STAT(++_stats.pops);
+                    detail::deliver(&entry, &entry + 1, *_pool, sink);
+                } else {
+                    GSK_STAT(++_stats.tombstones_skipped);
+                    _pool->destroy(entry);
+                }
+            }
+            return popped;
+        }
+
+        std::pair<Priority, const T&> peek() {
             while (_size > 0) {
-                detail::LazyEntry<T>* entry = _data[0];  // where the min time is
+                entry_type* entry = _data[0];  // where the min time is
                 if (entry->exist) {
                     return { entry->time, entry->payload };
                 }
                 // filter out non-existing entries
-                std::pop_heap(_data.begin(), _data.end(), detail::compare<T>);
+                std::pop_heap(_data.begin(), _data.end(), _cmp);
                 _data.pop_back();
-                delete entry; // and then delete
+                GSK_STAT(++_stats.tombstones_skipped);
+                _pool->destroy(entry); // and then recycle
             }
             throw std::runtime_error("Empty Queue");
         }
 
-        void remove(const ID& id) {
+        void remove(const ID& id) { remove<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        void remove(const Key& id) {
             auto it = _m.find(id);
             assert(it!=_m.end() && it->second->exist);
-            detail::LazyEntry<T>* entry = it->second;
+            entry_type* entry = it->second;
             _m.erase(it);
             entry->exist = false; // mark as deleted
             _size--;
+            GSK_STAT(++_stats.removes);
+            maybe_compact();
         }
 
+        // tombstones the current entry and re-inserts its payload at new_time
+        void reschedule(const ID& id, Priority new_time) { reschedule<ID>(id, new_time); }
+        template<typename Key, if_lookup<Key> = 0>
+        void reschedule(const Key& id, Priority new_time) {
+            auto it = _m.find(id);
+            assert(it!=_m.end() && it->second->exist);
+            entry_type* old_entry = it->second;
+            entry_type* entry = _pool->create(new_time, std::move(old_entry->payload));
+            old_entry->exist = false;  // left with a moved-from payload; never handed out again
+            it->second = entry;
+            _data.push_back(entry);
+            GSK_STAT(++_stats.reschedules);
+            std::push_heap(_data.begin(), _data.end(), _cmp);
+            maybe_compact();
+        }
+
+        [[nodiscard]] bool contains(const ID& id) const { return contains<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        [[nodiscard]] bool contains(const Key& id) const {
+            return _m.find(id) != _m.end();  // tombstones are not indexed
+        }
+
+        // drops every tombstone and rebuilds the heap in O(n)
+        void compact() {
+            auto dead = std::partition(_data.begin(), _data.end(), [](const entry_type* e) { return e->exist; });
+            for (auto it = dead; it != _data.end(); ++it) {
+                _pool->destroy(*it);
+            }
+            _data.erase(dead, _data.end());
+            std::make_heap(_data.begin(), _data.end(), _cmp);
+            GSK_STAT(++_stats.compactions);
+        }
+
+        // makes room for n live entries in the heap, the index and the pool
+        void reserve(size_type n) {
+            _data.reserve(n);
+            _m.reserve(n);
+            _pool->reserve(n);
+        }
+
+        // compaction kicks in when tombstones exceed this fraction of the heap; anything >= 1 disables it
+        void max_tombstone_ratio(double ratio) noexcept { _max_tombstone_ratio = ratio; }
+        [[nodiscard]] double max_tombstone_ratio() const noexcept { return _max_tombstone_ratio; }
+
         [[nodiscard]] auto size() const noexcept { return _size; }
+        // dead entries still in the heap
+        [[nodiscard]] size_type tombstones() const noexcept { return _data.size() - _size; }
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(_data.get_allocator()); }
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        // the counters, plus the current shape of the heap and of the index
+        [[nodiscard]] QueueStats stats() const {
+            QueueStats snapshot = _stats;
+            snapshot.size = size();
+            snapshot.heap_size = _data.size();
+            snapshot.heap_capacity = _data.capacity();
+            snapshot.index = detail::probe_stats(_m);
+            return snapshot;
+        }
+        void reset_stats() noexcept { _stats = {}; }
+#endif
     };
 }
 
+namespace data_structures {
+    // a radix heap: a min-queue for monotone workloads, where nothing is ever pushed/rescheduled
+    // below the last popped priority (e.g. discrete-event simulation clocks)
+    // bucket i>0 holds the entries whose priority first differs from the last popped one at bit i-1;
+    // bucket 0 holds the ones equal to it. each entry is redistributed at most once per bit, so pops are
+    // amortised O(log C) where C is the priority range, and remove/reschedule are O(1)
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            typename Priority=std::uint64_t, typename IdOf=DynamicIdOf<T, ID>, typename Index=NodeIndex>
+    class MonotoneQueue: public QueueBase<T, ID, Hash, KeyEqual, IdOf> {
+    static_assert(std::is_integral_v<Priority> && std::is_unsigned_v<Priority>,
+                  "a radix heap needs an unsigned integral priority");
+    static_assert(std::numeric_limits<Priority>::digits <= 64);
+    public:
+        using priority_type = Priority;
+        using entry_type = detail::RadixEntry<T, Priority>;
+        using pool_type = EntryPool<entry_type>;
+    private:
+        using bucket_type = std::vector<entry_type*>;
+        using size_type = typename bucket_type::size_type;
+        pool_type _own_pool;
+        pool_type* _pool{&_own_pool};  // either _own_pool or one supplied by the user
+        std::array<bucket_type, std::numeric_limits<Priority>::digits + 1> _buckets;
+        size_type _size{};
+        Priority _last{};  // the last popped priority; a lower bound of everything in the queue
+        typename Index::template map_type<ID, entry_type*, Hash, KeyEqual> _m;
+        // remove, reschedule and contains also take any Key that transparent Hash and KeyEqual accept
+        template<typename Key>
+        using if_lookup = detail::enable_lookup_t<Key, ID, Hash, KeyEqual, detail::index_heterogeneous<Index>::value>;
+    private:
+        [[nodiscard]] unsigned bucket_of(Priority time) const noexcept {
+            return detail::bit_width(static_cast<std::uint64_t>(time ^ _last));
+        }
+        void check_monotone(Priority time) const {
+            if (time < _last) {
+                throw std::runtime_error("priority below the last popped one");
+            }
+        }
+        void link(entry_type* entry) {
+            bucket_type& bucket = _buckets[entry->bucket];
+            entry->loc = bucket.size();
+            bucket.push_back(entry);
+        }
+        void unlink(entry_type* entry) {  // swap with the last entry of the same bucket
+            bucket_type& bucket = _buckets[entry->bucket];
+            if (entry->loc != bucket.size() - 1) {
+                bucket[entry->loc] = bucket.back();
+                bucket[entry->loc]->loc = entry->loc;
+            }
+            bucket.pop_back();
+        }
+        // makes sure bucket 0 holds the minima; requires a non-empty queue
+        void refill() {
+            if (!_buckets[0].empty()) { return; }
+            unsigned i = 1;
+            while (_buckets[i].empty()) { ++i; }
+            bucket_type& bucket = _buckets[i];
+            auto min_it = std::min_element(bucket.begin(), bucket.end(),
+                                           [](const entry_type* e1, const entry_type* e2) { return e1->time < e2->time; });
+            _last = (*min_it)->time;
+            for (entry_type* entry: bucket) {  // every entry lands in a lower bucket
+                entry->bucket = bucket_of(entry->time);
+                link(entry);
+            }
+            bucket.clear();
+        }
+    public:
+        MonotoneQueue() = default;
+
+        template<typename F>
+        explicit MonotoneQueue(F f): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {}
+
+        // entries are drawn from (and returned to) pool, which must outlive the queue
+        explicit MonotoneQueue(pool_type& pool): _pool{&pool} {}
+        template<typename F>
+        MonotoneQueue(F f, pool_type& pool): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _pool{&pool} {}
+
+        MonotoneQueue(const MonotoneQueue& other) = delete;
+        MonotoneQueue(MonotoneQueue&& other) = delete;
+        MonotoneQueue& operator=(const MonotoneQueue& other) = delete;
+        MonotoneQueue& operator=(MonotoneQueue&& other) = delete;
+
+        ~MonotoneQueue() {
+            for (bucket_type& bucket: _buckets) {
+                for (entry_type* entry: bucket) {
+                    _pool->destroy(entry);
+                }
+            }
+        }
+
+        template<typename ...Arg>
+        void push(Priority time, Arg&&... args) {
+            check_monotone(time);
+            auto* entry = _pool->create(bucket_of(time), 0, time, std::forward<Arg>(args)...);
+            ID id = this->convert(entry->payload);
+            assert(!_m.count(id));
+            link(entry);
+            _m.emplace(std::move(id), entry);
+            ++_size;
+        }
+
+        std::pair<Priority, T> pop() {
+            if (_size == 0) {
+                throw std::runtime_error("Empty Queue");
+            }
+            refill();
+            entry_type* entry = _buckets[0].back();
+            _buckets[0].pop_back();
+            --_size;
+            auto it = _m.find(this->convert(entry->payload));  // the ID is resolved only once
+            assert(it!=_m.end());
+            _m.erase(it);
+            std::pair<Priority, T> result{ entry->time, std::move(entry->payload) };  // move the payload out
+            _pool->destroy(entry);  // and then recycle
+            return result;
+        }
+
+        std::pair<Priority, const T&> peek() {
+            if (_size == 0) {
+                throw std::runtime_error("Empty Queue");
+            }
+            refill();
+            entry_type* entry = _buckets[0].back();
+            return { entry->time, entry->payload };
+        }
+
+        void remove(const ID& id) { remove<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        void remove(const Key& id) {
+            auto it = _m.find(id);
+            assert(it!=_m.end());
+            entry_type* entry = it->second;
+            _m.erase(it);
+            unlink(entry);
+            _pool->destroy(entry);
+            --_size;
+        }
+
+        // new_time can be lower than the current one, but not lower than the last popped priority
+        void reschedule(const ID& id, Priority new_time) { reschedule<ID>(id, new_time); }
+        template<typename Key, if_lookup<Key> = 0>
+        void reschedule(const Key& id, Priority new_time) {
+            check_monotone(new_time);
+            auto it = _m.find(id);
+            assert(it!=_m.end());
+            entry_type* entry = it->second;
+            unlink(entry);
+            entry->time = new_time;
+            entry->bucket = bucket_of(new_time);
+            link(entry);
+        }
+
+        [[nodiscard]] bool contains(const ID& id) const { return contains<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        [[nodiscard]] bool contains(const Key& id) const {
+            return _m.find(id) != _m.end();
+        }
+
+        // makes room for n entries in the index and the pool
+        void reserve(size_type n) {
+            _m.reserve(n);
+            _pool->reserve(n);
+        }
+
+        [[nodiscard]] auto size() const noexcept { return _size; }
+    };
+}
+
+namespace data_structures {
+    // a pairing heap: subtrees hang off their roots by pointers, so a key that decreases is cut out with its subtree
+    // and linked under the root in O(1) (and amortised o(log n) in theory, close to O(1) in practice), which suits
+    // graph searches that relax many edges; pops are amortised O(log n)
+    // the entry whose Priority compares least under Compare is on top
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            typename Priority=double, typename Compare=std::less<Priority>, typename IdOf=DynamicIdOf<T, ID>,
+            typename Index=NodeIndex>
+    class PairingQueue: public QueueBase<T, ID, Hash, KeyEqual, IdOf> {
+    public:
+        using priority_type = Priority;
+        using entry_type = detail::PairingEntry<T, Priority>;
+        using pool_type = EntryPool<entry_type>;
+    private:
+        Compare _cmp;
+        pool_type _own_pool;
+        pool_type* _pool{&_own_pool};  // either _own_pool or one supplied by the user
+        entry_type* _root{nullptr};
+        std::size_t _size{};
+        using index_type = typename Index::template map_type<ID, entry_type*, Hash, KeyEqual>;
+        index_type _m;
+        using size_type = std::size_t;
+        // remove, reschedule and contains also take any Key that transparent Hash and KeyEqual accept
+        template<typename Key>
+        using if_lookup = detail::enable_lookup_t<Key, ID, Hash, KeyEqual, detail::index_heterogeneous<Index>::value>;
+    private:
+        // links two roots (either may be null); the one that compares greater becomes the leftmost child
+        entry_type* meld(entry_type* a, entry_type* b) {
+            if (!a) { return b; }
+            if (!b) { return a; }
+            if (_cmp(b->time, a->time)) { std::swap(a, b); }
+            b->next = a->child;
+            if (a->child) { a->child->prev = b; }
+            b->prev = a;
+            a->child = b;
+            return a;
+        }
+        // detaches a non-root entry, with its subtree, from its parent and siblings
+        void cut(entry_type* entry) {
+            if (entry->prev->child == entry) {
+                entry->prev->child = entry->next;
+            } else {
+                entry->prev->next = entry->next;
+            }
+            if (entry->next) { entry->next->prev = entry->prev; }
+            entry->prev = entry->next = nullptr;
+        }
+        // the standard two-pass pairing of a list of siblings into one root, without recursion:
+        // meld them pairwise left to right, then fold the pairs into one from right to left
+        entry_type* merge_pairs(entry_type* first) {
+            if (!first) { return nullptr; }
+            entry_type* pairs = nullptr;  // melded pairs, the last one first, chained through next
+            while (first) {
+                entry_type* a = first;
+                entry_type* b = a->next;
+                first = b ? b->next : nullptr;
+                a->prev = a->next = nullptr;
+                if (b) { b->prev = b->next = nullptr; }
+                entry_type* pair = meld(a, b);
+                pair->next = pairs;
+                pairs = pair;
+            }
+            entry_type* root = pairs;
+            pairs = pairs->next;
+            root->next = nullptr;
+            while (pairs) {
+                entry_type* following = pairs->next;
+                pairs->next = nullptr;
+                root = meld(root, pairs);
+                pairs = following;
+            }
+            return root;
+        }
+        // takes entry out of the heap, leaving it a lone root; its children are paired up in its place
+        void detach(entry_type* entry) {
+            if (entry == _root) {
+                _root = merge_pairs(entry->child);
+            } else {
+                cut(entry);
+                _root = meld(_root, merge_pairs(entry->child));
+            }
+            entry->child = nullptr;
+        }
+        void unmap(const entry_type* entry) {
+            auto it = _m.find(this->convert(entry->payload));  // the ID is resolved only once
+            assert(it!=_m.end());
+            _m.erase(it);
+        }
+    public:
+        PairingQueue() = default;
+
+        template<typename F>
+        explicit PairingQueue(F f): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)} {}
+
+        // entries are drawn from (and returned to) pool, which must outlive the queue
+        explicit PairingQueue(pool_type& pool): _pool{&pool} {}
+        template<typename F>
+        PairingQueue(F f, pool_type& pool): QueueBase<T, ID, Hash, KeyEqual, IdOf>{std::move(f)}, _pool{&pool} {}
+
+        PairingQueue(const PairingQueue& other) = delete;
+        PairingQueue& operator=(const PairingQueue& other) = delete;
+
+        // the tree, the index and the entries change hands without being copied; see EagerQueue
+        PairingQueue(PairingQueue&& other) noexcept(std::is_nothrow_move_constructible_v<index_type>):
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>(std::move(other)), _cmp(std::move(other._cmp)),
+            _own_pool(std::move(other._own_pool)), _pool(other._pool == &other._own_pool ? &_own_pool : other._pool),
+            _root(std::exchange(other._root, nullptr)), _size(std::exchange(other._size, 0)), _m(std::move(other._m)) {
+            other._m.clear();
+        }
+        PairingQueue& operator=(PairingQueue&& other) {
+            if (this == &other) { return *this; }
+            clear();
+            QueueBase<T, ID, Hash, KeyEqual, IdOf>::operator=(std::move(other));
+            _cmp = std::move(other._cmp);
+            merge(other);
+            return *this;
+        }
+
+        ~PairingQueue() { clear(); }
+
+        // moves every entry of other into this queue and leaves other empty; no ID may be queued in both
+        // when both share a pool, or other has its own, the two trees are melded in O(1) and only the index
+        // takes O(m); otherwise other is drained into this queue pop by pop
+        void merge(PairingQueue& other) {
+            if (this == &other || !other._root) { return; }
+            if (_pool != other._pool && other._pool != &other._own_pool) {
+                while (other._root) {
+                    auto [time, payload] = other.pop();
+                    push(std::move(time), std::move(payload));
+                }
+                return;
+            }
+            _m.reserve(_size + other._size);
+            if (_pool != other._pool) { _pool->absorb(other._own_pool); }
+            for (auto& kv: other._m) {
+                ID id = this->convert(kv.second->payload);
+                assert(!_m.count(id));
+                _m.emplace(std::move(id), kv.second);
+            }
+            _root = meld(_root, std::exchange(other._root, nullptr));
+            _size += std::exchange(other._size, 0);
+            other._m.clear();
+        }
+
+        // destroys every entry
+        void clear() noexcept {
+            for (auto& kv: _m) {  // the index reaches every entry without walking the tree
+                _pool->destroy(kv.second);
+            }
+            _m.clear();
+            _root = nullptr;
+            _size = 0;
+        }
+
+        template<typename ...Arg>
+        void push(Priority time, Arg&&... args) {
+            auto* entry = _pool->create(std::move(time), std::forward<Arg>(args)...);
+            ID id = this->convert(entry->payload);
+            assert(!_m.count(id));
+            _m.emplace(std::move(id), entry);
+            _root = meld(_root, entry);
+            ++_size;
+        }
+
+        std::pair<Priority, T> pop() {
+            if (!_root) {
+                throw std::runtime_error("Empty Queue");
+            }
+            entry_type* top = _root;
+            detach(top);
+            unmap(top);
+            --_size;
+            std::pair<Priority, T> result{ top->time, std::move(top->payload) };  // move the payload out
+            _pool->destroy(top);  // and then recycle
+            return result;
+        }
+
+        // pops every entry due by time (i.e. not after it) in priority order into sink; see EagerQueue::pop_until
+        template<typename Sink>
+        size_type pop_until(const Priority& time, Sink sink) {
+            size_type n = 0;
+            for (; _root && !_cmp(time, _root->time); ++n) {
+                entry_type* top = _root;
+                detach(top);
+                unmap(top);
+                --_size;
+                detail::deliver(&top, &top + 1, *_pool, sink);
+            }
+            return n;
+        }
+
+        // pops the first (at most) n entries in priority order into sink; see EagerQueue::pop_until
+        template<typename Sink>
+        size_type pop_n(size_type n, Sink sink) {
+            n = std::min(n, _size);
+            for (size_type i = 0; i < n; ++i) {
+                entry_type* top = _root;
+                detach(top);
+                unmap(top);
+                --_size;
+                detail::deliver(&top, &top + 1, *_pool, sink);
+            }
+            return n;
+        }
+
+        std::pair<Priority, const T&> peek() const {
+            if (!_root) {
+                throw std::runtime_error("Empty Queue");
+            }
+            return { _root->time, _root->payload };
+        }
+
+        void remove(const ID& id) { remove<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        void remove(const Key& id) {
+            auto it = _m.find(id);
+            assert(it!=_m.end());
+            entry_type* entry = it->second;
+            _m.erase(it);
+            detach(entry);
+            --_size;
+            _pool->destroy(entry);
+        }
+
+        // a decrease (new_time not after the current one) cuts the entry's subtree and links it under the root,
+        // in O(1); an increase takes the entry out and melds it back
+        void reschedule(const ID& id, Priority new_time) { reschedule<ID>(id, new_time); }
+        template<typename Key, if_lookup<Key> = 0>
+        void reschedule(const Key& id, Priority new_time) {
+            auto it = _m.find(id);
+            assert(it!=_m.end());
+            entry_type* entry = it->second;
+            const bool decrease = !_cmp(entry->time, new_time);
+            entry->time = std::move(new_time);
+            if (!decrease) {
+                detach(entry);
+            } else if (entry != _root) {
+                cut(entry);
+            } else {
+                return;  // still on top
+            }
+            _root = meld(_root, entry);
+        }
+
+        [[nodiscard]] bool contains(const ID& id) const { return contains<ID>(id); }
+        template<typename Key, if_lookup<Key> = 0>
+        [[nodiscard]] bool contains(const Key& id) const {
+            return _m.find(id) != _m.end();
+        }
+
+        // makes room for n entries in the index and the pool
+        void reserve(size_type n) {
+            _m.reserve(n);
+            _pool->reserve(n);
+        }
+
+        [[nodiscard]] auto size() const noexcept { return _size; }
+    };
+}
+
+#ifdef __cpp_lib_memory_resource
+namespace data_structures::pmr {
+    // the queues on a std::pmr::memory_resource, e.g. pmr::EagerQueue<int> q{&arena}
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            std::size_t Arity=2, typename Priority=double, typename Compare=std::less<Priority>,
+            typename IdOf=DynamicIdOf<T, ID>, typename Index=NodeIndex>
+    using EagerQueue = data_structures::EagerQueue<T, ID, Hash, KeyEqual, Arity, Priority, Compare, IdOf, Index,
+            std::pmr::polymorphic_allocator<T>>;
+
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            typename Priority=double, typename Compare=std::less<Priority>, typename IdOf=DynamicIdOf<T, ID>,
+            typename Index=NodeIndex>
+    using LazyQueue = data_structures::LazyQueue<T, ID, Hash, KeyEqual, Priority, Compare, IdOf, Index,
+            std::pmr::polymorphic_allocator<T>>;
+}
+#endif
+
 #endif //GSK_HASHQUEUE_H
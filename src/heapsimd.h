@@ -0,0 +1,79 @@
+#ifndef GSK_HEAPSIMD_H
+#define GSK_HEAPSIMD_H
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+
+// vectorised minimum-child search for d-ary heaps whose priorities sit in a contiguous array
+// SSE2 (AVX for 8-wide blocks when enabled) on x86-64, NEON on AArch64; define DATA_STRUCTURES_NO_SIMD to opt out
+#if !defined(DATA_STRUCTURES_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#define GSK_HEAP_SIMD_SSE2 1
+#elif !defined(DATA_STRUCTURES_NO_SIMD) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GSK_HEAP_SIMD_NEON 1
+#endif
+
+namespace data_structures::detail {
+    // whether simd_min_child handles a full block of Arity children ordered by Compare
+    template<std::size_t Arity, typename Priority, typename Compare>
+    inline constexpr bool has_simd_min_child =
+#if defined(GSK_HEAP_SIMD_SSE2) || defined(GSK_HEAP_SIMD_NEON)
+            std::is_same_v<Priority, double> && (Arity == 4 || Arity == 8)
+            && (std::is_same_v<Compare, std::less<double>> || std::is_same_v<Compare, std::less<>>);
+#else
+            false;
+#endif
+
+    inline unsigned lowest_bit(unsigned mask) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#else
+        unsigned i = 0;
+        for (; !(mask & 1U); mask >>= 1U) { ++i; }
+        return i;
+#endif
+    }
+
+    // the index of the least of keys[0, Arity), the first one on ties, as in a scalar scan with <
+    // returns Arity when no key compares equal to the minimum (a NaN), for the caller to scan instead
+    template<std::size_t Arity>
+    std::size_t simd_min_child(const double* keys) noexcept {
+        static_assert(Arity % 2 == 0);
+#if defined(GSK_HEAP_SIMD_SSE2)
+#if defined(__AVX__)
+        if constexpr (Arity == 8) {
+            const __m256d lo = _mm256_loadu_pd(keys), hi = _mm256_loadu_pd(keys + 4);
+            __m256d least = _mm256_min_pd(lo, hi);
+            least = _mm256_min_pd(least, _mm256_permute2f128_pd(least, least, 1));
+            least = _mm256_min_pd(least, _mm256_shuffle_pd(least, least, 5));  // every lane holds the minimum
+            const auto mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(lo, least, _CMP_EQ_OQ)))
+                              | static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(hi, least, _CMP_EQ_OQ))) << 4U;
+            return mask ? lowest_bit(mask) : Arity;
+        }
+#endif
+        __m128d least = _mm_loadu_pd(keys);
+        for (std::size_t i = 2; i < Arity; i += 2) { least = _mm_min_pd(least, _mm_loadu_pd(keys + i)); }
+        least = _mm_min_pd(least, _mm_shuffle_pd(least, least, 1));  // both lanes hold the minimum
+        unsigned mask = 0;
+        for (std::size_t i = 0; i < Arity; i += 2) {
+            mask |= static_cast<unsigned>(_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(keys + i), least))) << i;
+        }
+        return mask ? lowest_bit(mask) : Arity;
+#elif defined(GSK_HEAP_SIMD_NEON)
+        float64x2_t least = vld1q_f64(keys);
+        for (std::size_t i = 2; i < Arity; i += 2) { least = vminq_f64(least, vld1q_f64(keys + i)); }
+        const double min = vminvq_f64(least);
+        for (std::size_t i = 0; i < Arity; ++i) {  // the block is in cache by now
+            if (keys[i] == min) { return i; }
+        }
+        return Arity;
+#else
+        (void) keys;
+        return Arity;
+#endif
+    }
+}
+
+#endif //GSK_HEAPSIMD_H
@@ -6,35 +6,180 @@
 #include <stdexcept>
 #include <random>
 #include <unordered_set>
+#include <algorithm>
+#include <limits>
+#include <iterator>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <system_error>
+#include <cstddef>
+
+#include "flatmap.h"
+#include "randomengine.h"
+#include "cowvector.h"
+#include "flatimage.h"
+#include "stats.h"
+
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+
+namespace data_structures::detail {
+    template<typename It, typename = void>
+    struct is_iterator: std::false_type {};
+    template<typename It>
+    struct is_iterator<It, std::void_t<typename std::iterator_traits<It>::iterator_category>>: std::true_type {};
+    template<typename It>
+    using if_iterator = std::enable_if_t<is_iterator<It>::value, int>;
+    // an iterator that is not a key itself, so that insert(first, last) means a range and never a key built in place
+    // from two arguments, such as a std::string from two const char*
+    template<typename It, typename K>
+    using if_key_range = std::enable_if_t<is_iterator<It>::value && !std::is_constructible_v<K, const It&>, int>;
+
+    // how many elements [first, last) holds, if that can be known without consuming it
+    template<typename It>
+    std::size_t distance_hint(It first, It last) {
+        using category = typename std::iterator_traits<It>::iterator_category;
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+            return static_cast<std::size_t>(std::distance(first, last));
+        } else {
+            return 0;
+        }
+    }
+
+    // calls f(i) for k indices drawn uniformly from [0, n) with replacement; n must be positive
+    template<typename Rng, typename F>
+    void sample_indices(std::size_t n, std::size_t k, Rng& rng, F&& f) {
+        for (std::size_t i = 0; i < k; ++i) {
+            f(static_cast<std::size_t>(bounded(rng, n)));
+        }
+    }
+
+    // calls f(i) for min(k, n) distinct indices drawn uniformly from [0, n), in no particular order
+    // Floyd's algorithm when k is small next to n; partial Fisher-Yates over all indices otherwise
+    template<typename Rng, typename F>
+    void sample_distinct_indices(std::size_t n, std::size_t k, Rng& rng, F&& f) {
+        k = std::min(k, n);
+        if (2 * k <= n) {
+            std::unordered_set<std::size_t> chosen;
+            chosen.reserve(k);
+            for (std::size_t j = n - k; j < n; ++j) {
+                auto t = static_cast<std::size_t>(bounded(rng, j + 1));
+                if (!chosen.insert(t).second) {  // t taken already; j cannot be, as it was out of range so far
+                    t = j;
+                    chosen.insert(t);
+                }
+                f(t);
+            }
+        } else {
+            std::vector<std::size_t> indices(n);
+            for (std::size_t i = 0; i < n; ++i) { indices[i] = i; }
+            for (std::size_t i = 0; i < k; ++i) {
+                std::swap(indices[i], indices[i + static_cast<std::size_t>(bounded(rng, n - i))]);
+                f(indices[i]);
+            }
+        }
+    }
+
+    // runs body(first, last) over [0, n) cut into contiguous chunks, one per thread, the calling thread
+    // taking the first; chunks are at least min_chunk long, so small ranges stay on one thread
+    // the first exception thrown by body is rethrown once every chunk is done
+    template<typename Body>
+    void parallel_chunks(std::size_t n, unsigned threads, Body&& body) {
+        constexpr std::size_t min_chunk = std::size_t{1} << 14U;
+        const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(threads, n / min_chunk));
+        std::exception_ptr error;
+        std::mutex error_mutex;
+        auto run = [&](std::size_t c) {
+            try {
+                body(n * c / chunks, n * (c + 1) / chunks);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) { error = std::current_exception(); }
+            }
+        };
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+        for (std::size_t c = 1; c < chunks; ++c) {
+            try {
+                workers.emplace_back(run, c);
+            } catch (const std::system_error&) {  // out of threads: the calling one does the chunk
+                run(c);
+            }
+        }
+        run(0);
+        for (auto& worker: workers) { worker.join(); }
+        if (error) { std::rethrow_exception(error); }
+    }
+}
 
 
 namespace data_structures {
+    // every container here takes its engine as the last parameter (but for RandomSet's and RandomDict's allocator);
+    // any UniformRandomBitGenerator will do (see randomengine.h for small-state ones), and with a full 32- or 64-bit
+    // engine the picks depend on the engine alone, so a seed reproduces them on every standard library
     template<typename K,
             typename Hash=std::hash<K>,
-            typename KeyEqual=std::equal_to<K>>
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937,
+            typename Allocator=std::allocator<K>>
     class RandomSet {
+    public:
+        using allocator_type = Allocator;
     private:
-        // this design is possible because unordered_map never invalidates references/pointers
-        std::vector<const K*> v;
+        // v holds an iterator to each node of m, so that the swap-with-last re-points the moved index, and
+        // erasing by index unlinks the node, without hashing any key
+        using map_type = std::unordered_map<K, std::size_t, Hash, KeyEqual,
+                detail::rebind_alloc_t<Allocator, std::pair<const K, std::size_t>>>;
+        using node_iterator = typename map_type::iterator;
+        std::vector<node_iterator, detail::rebind_alloc_t<Allocator, node_iterator>> v;
         using size_type = typename decltype(v)::size_type;
-        std::unordered_map<K, size_type, Hash, KeyEqual> m;
-        mutable std::mt19937 rng;
+        map_type m;
+        mutable Engine rng;
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        mutable RandomStats _stats;  // draws are counted by const members
+#endif
     private:
+        // rehashing invalidates iterators into m, though not its nodes, so v is re-pointed after each rehash,
+        // in O(n) as often as the table grows; a rehash shows as a change in the bucket count
+        void relink() {
+            for (auto it = m.begin(); it != m.end(); ++it) { v[it->second] = it; }
+        }
+        void relink_if(size_type buckets) {
+            if (m.bucket_count() != buckets) { relink(); }
+        }
         void align_v() {  // direct entries in v to keys in m
             v.clear();  // defensive coding...
             v.resize(m.size());
-            for (const auto& [key, idx]: m) {
-                v.at(idx) = &key;  // pointing to the entry in m
+            relink();
+        }
+        void fill_hole(size_type idx) {  // the node v[idx] pointed to is gone from m; the last entry moves in
+            if (idx != v.size() - 1) {
+                v[idx] = v.back();
+                v[idx]->second = idx;
+                GSK_STAT(++_stats.hole_fills);
             }
+            GSK_STAT(++_stats.erases);
+            v.pop_back();
         }
     public:
-        explicit RandomSet(uint32_t seed): v{}, m{}, rng{seed} {}
+        explicit RandomSet(typename Engine::result_type seed): v{}, m{}, rng(seed) {}
+        // the dense storage and the map nodes both allocate from alloc
+        RandomSet(typename Engine::result_type seed, const Allocator& alloc): v(alloc), m(alloc), rng(seed) {}
         RandomSet() = delete;
 
-        RandomSet(const RandomSet& other): v{}, m{other.m}, rng(other.rng) { align_v(); }
-        // nothing is copied or moved by calling merge; meaning that references in v are still valid
-        RandomSet(RandomSet&& other) noexcept: v{std::move(other.v)}, m{}, rng{std::move(other.rng)} {
+        RandomSet(const RandomSet& other):
+            v(std::allocator_traits<typename decltype(v)::allocator_type>::select_on_container_copy_construction(
+                    other.v.get_allocator())),
+            m{other.m}, rng(other.rng) { align_v(); }
+        // nothing is copied or moved by calling merge, but the iterators in v have to be re-pointed
+        RandomSet(RandomSet&& other) noexcept: v{std::move(other.v)}, m{other.m.get_allocator()}, rng{std::move(other.rng)} {
             m.merge(std::move(other.m));
+            relink();
         }
 
         RandomSet& operator=(const RandomSet& other) {
@@ -46,56 +191,161 @@ namespace data_structures {
             return *this;
         }
 
-        RandomSet& operator=(RandomSet&& other) noexcept {
-            if (this!=&other) {
+        // merge needs equal allocators; with ones that differ (e.g. two std::pmr arenas) the keys are copied instead
+        RandomSet& operator=(RandomSet&& other)
+                noexcept(std::allocator_traits<typename map_type::allocator_type>::is_always_equal::value) {
+            if (this!=&other && m.get_allocator() != other.m.get_allocator()) {
+                *this = other;
+                other.clear();
+            } else if (this!=&other) {
                 v = std::move(other.v);
                 rng = std::move(other.rng);
                 m.clear();
                 m.merge(std::move(other.m));
+                relink();
             }
             return *this;
         }
 
         ~RandomSet() = default;
 
+        // lookups by other key types, given transparent Hash and KeyEqual; std::unordered_map needs C++20 for them
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, detail::unordered_heterogeneous>;
+
         auto count(const K& key) const { return m.count(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        auto count(const KT& key) const { return m.count(key); }
         [[nodiscard]] auto size() const noexcept { return v.size(); }
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(v.get_allocator()); }
         void clear() noexcept {
             v.clear();
             m.clear();
         }
 
+        // capacity control acts on the dense storage and the map together
+        void reserve(size_type n) {
+            const size_type buckets = m.bucket_count();
+            v.reserve(n);
+            m.reserve(n);
+            relink_if(buckets);
+        }
+        void rehash(size_type bucket_count) {
+            const size_type buckets = m.bucket_count();
+            m.rehash(bucket_count);
+            relink_if(buckets);
+        }
+        [[nodiscard]] size_type bucket_count() const noexcept { return m.bucket_count(); }
+        [[nodiscard]] float load_factor() const noexcept { return m.load_factor(); }
+        [[nodiscard]] float max_load_factor() const noexcept { return m.max_load_factor(); }
+        void max_load_factor(float ml) {
+            const size_type buckets = m.bucket_count();
+            m.max_load_factor(ml);
+            relink_if(buckets);
+        }
+        // gives back what a large purge left behind
+        void shrink_to_fit() {
+            v.shrink_to_fit();
+            rehash(0);  // the fewest buckets that keep the load factor within bounds
+        }
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        // the counters, plus the current shape of the dense storage and of the map
+        [[nodiscard]] RandomStats stats() const {
+            RandomStats snapshot = _stats;
+            snapshot.size = v.size();
+            snapshot.capacity = v.capacity();
+            snapshot.index = detail::probe_stats(m);
+            return snapshot;
+        }
+        void reset_stats() noexcept { _stats = {}; }
+#endif
+
         template<typename ...KT>
         int insert(KT&&... key) noexcept {
             static_assert(std::is_constructible_v<K, KT...>);
+            const size_type buckets = m.bucket_count();
             auto [it, insertion_happens] = m.emplace(std::piecewise_construct,
                                                      std::forward_as_tuple(key...),
                                                      std::forward_as_tuple(v.size()));  // construct key in-place
             if (insertion_happens) {
-                v.emplace_back(&(it->first));
+                v.emplace_back(it);
+                relink_if(buckets);
+                GSK_STAT(++_stats.inserts);
                 return 1;
             } else {  // value already exists -> no-op
                 return 0;
             }
         }
 
-        int erase(const K& key) noexcept {
+        int erase(const K& key) noexcept { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        int erase(const KT& key) noexcept {
             auto iter = m.find(key);
             if (iter == m.end()) { return 0; }  // no-op if not found
             size_type index_removed = iter->second;
-            m.erase(iter);  // the corresponding ptr in v becomes dangling now
-            if (index_removed != v.size() - 1) {  // not the last entry
-                v[index_removed] = v.back();  // v entry redirected; not dangling anymore
-                m.at(*(v.back())) = index_removed;  // m entry redirected
-            }
-            v.pop_back();  // shrink the last entry out
+            m.erase(iter);  // the corresponding iterator in v becomes dangling now
+            fill_hole(index_removed);  // and is overwritten or popped here
             return 1;
         }
 
+        // inserts every key in [first, last), reserving up front when the length is known; returns how many were new
+        template<typename InputIt, detail::if_key_range<InputIt, K> = 0>
+        size_type insert(InputIt first, InputIt last) {
+            reserve(v.size() + detail::distance_hint(first, last));
+            size_type inserted = 0;
+            for (; first != last; ++first) { inserted += insert(*first); }
+            return inserted;
+        }
+
+        // erases every key in [first, last) and returns how many were present
+        template<typename InputIt, detail::if_iterator<InputIt> = 0>
+        size_type erase(InputIt first, InputIt last) {
+            std::vector<size_type, detail::rebind_alloc_t<Allocator, size_type>> holes(v.get_allocator());
+            for (; first != last; ++first) {
+                auto iter = m.find(*first);
+                if (iter == m.end()) { continue; }
+                holes.push_back(iter->second);
+                m.erase(iter);
+            }
+            // filled from the back, the last entry is never a hole still pending
+            std::sort(holes.begin(), holes.end(), std::greater<>());
+            for (size_type idx: holes) { fill_hole(idx); }
+            return holes.size();
+        }
+
+        // removes and returns a uniformly random key, unlinked through its iterator in v without being hashed,
+        // and moved out of its node rather than copied
+        K pop_random() {
+            if (v.empty()) { throw std::runtime_error("empty set"); }
+            const size_type idx = detail::bounded(rng, v.size());
+            auto node = m.extract(v[idx]);
+            fill_hole(idx);
+            return std::move(node.key());
+        }
+
         const K& random_elem() const {
             if (v.empty()) { throw std::runtime_error("empty set"); }
-            std::uniform_int_distribution<size_type> uniform_distrib(0, v.size() - 1);
-            return *(v.at(uniform_distrib(rng)));
+            GSK_STAT(++_stats.draws);
+            return v[detail::bounded(rng, v.size())]->first;
+        }
+
+        // writes k keys drawn with replacement to out
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            if (k == 0) { return out; }
+            if (v.empty()) { throw std::runtime_error("empty set"); }
+            GSK_STAT(_stats.draws += k);
+            detail::sample_indices(v.size(), k, rng, [&](size_type i) { *out = v[i]->first; ++out; });
+            return out;
+        }
+
+        // writes min(k, size()) distinct keys to out, in no particular order
+        template<typename OutputIt>
+        OutputIt sample_distinct(size_type k, OutputIt out) const {
+            GSK_STAT(_stats.draws += std::min(k, v.size()));
+            detail::sample_distinct_indices(v.size(), k, rng, [&](size_type i) { *out = v[i]->first; ++out; });
+            return out;
         }
     };
 }
@@ -104,29 +354,121 @@ namespace data_structures {
 namespace data_structures {
     template<typename K, typename V,
             typename Hash=std::hash<K>,
-            typename KeyEqual=std::equal_to<K>>
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937,
+            typename Allocator=std::allocator<std::pair<const K, V>>>
     class RandomDict {
     static_assert(std::is_default_constructible_v<V>, "the mapped type, V, should be default constructible");
+    public:
+        using allocator_type = Allocator;
     private:
-        std::vector<std::pair<const K*, V>> v;
+        using map_type = std::unordered_map<K, std::size_t, Hash, KeyEqual,
+                detail::rebind_alloc_t<Allocator, std::pair<const K, std::size_t>>>;
+        using entry_type = std::pair<typename map_type::iterator, V>;
+        std::vector<entry_type, detail::rebind_alloc_t<Allocator, entry_type>> v;  // iterators to nodes of m; see RandomSet
         using size_type = typename decltype(v)::size_type;
-        std::unordered_map<K, size_type, Hash, KeyEqual> m;
-        mutable std::mt19937 rng;
+        map_type m;
+        mutable Engine rng;
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        mutable RandomStats _stats;
+#endif
     private:
+        void relink() {  // see RandomSet
+            for (auto it = m.begin(); it != m.end(); ++it) { v[it->second].first = it; }
+        }
+        void relink_if(size_type buckets) {
+            if (m.bucket_count() != buckets) { relink(); }
+        }
         void align_v(const RandomDict& other) {
             v.clear();
             v.resize(m.size());
-            for (const auto& [key, idx]: m) {
-                v.at(idx) = std::make_pair(&key, other.v.at(idx).second);
+            for (auto it = m.begin(); it != m.end(); ++it) {
+                v[it->second] = std::make_pair(it, other.v[it->second].second);
             }
         }
+        template<typename KT>
+        size_type find_or_throw(const KT& key) const {  // m.at takes no other key types
+            auto it = m.find(key);
+            if (it == m.end()) { throw std::out_of_range("key not found"); }
+            return it->second;
+        }
+        void fill_hole(size_type idx) {  // see RandomSet
+            if (idx != v.size() - 1) {
+                v[idx] = std::move(v.back());
+                v[idx].first->second = idx;
+                GSK_STAT(++_stats.hole_fills);
+            }
+            GSK_STAT(++_stats.erases);
+            v.pop_back();
+        }
+        std::pair<K, V> pop_at(size_type idx) {
+            V val = std::move(v[idx].second);
+            auto node = m.extract(v[idx].first);
+            fill_hole(idx);
+            return {std::move(node.key()), std::move(val)};
+        }
     public:
-        explicit RandomDict(uint32_t seed): v{}, m{}, rng{seed} {}
+        // random-access iterators over the dense storage, in storage order; they dereference to
+        // std::pair<const K&, V&> (const V& for const_iterator), so a scan never touches the map
+        // insertion and erasure invalidate every iterator, as with std::vector
+        template<bool Const>
+        class Iterator {
+            friend class RandomDict;
+            template<bool> friend class Iterator;
+            using entry_ptr = std::conditional_t<Const, const entry_type*, entry_type*>;
+            entry_ptr _entry{nullptr};
+            explicit Iterator(entry_ptr entry): _entry{entry} {}
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = std::pair<K, V>;
+            using difference_type = std::ptrdiff_t;
+            using reference = std::pair<const K&, std::conditional_t<Const, const V&, V&>>;
+            struct pointer {  // operator-> has to hand out the proxy by value
+                reference ref;
+                const reference* operator->() const { return &ref; }
+            };
+
+            Iterator() = default;
+            template<bool C=Const, std::enable_if_t<C, bool> = true>
+            Iterator(const Iterator<false>& other): _entry{other._entry} {}
+
+            reference operator*() const { return {_entry->first->first, _entry->second}; }
+            pointer operator->() const { return {**this}; }
+            reference operator[](difference_type n) const { return *(*this + n); }
+
+            Iterator& operator++() { ++_entry; return *this; }
+            Iterator operator++(int) { Iterator old = *this; ++_entry; return old; }
+            Iterator& operator--() { --_entry; return *this; }
+            Iterator operator--(int) { Iterator old = *this; --_entry; return old; }
+            Iterator& operator+=(difference_type n) { _entry += n; return *this; }
+            Iterator& operator-=(difference_type n) { _entry -= n; return *this; }
+            friend Iterator operator+(Iterator it, difference_type n) { return it += n; }
+            friend Iterator operator+(difference_type n, Iterator it) { return it += n; }
+            friend Iterator operator-(Iterator it, difference_type n) { return it -= n; }
+            friend difference_type operator-(const Iterator& lhs, const Iterator& rhs) { return lhs._entry - rhs._entry; }
+
+            friend bool operator==(const Iterator& lhs, const Iterator& rhs) { return lhs._entry == rhs._entry; }
+            friend bool operator!=(const Iterator& lhs, const Iterator& rhs) { return lhs._entry != rhs._entry; }
+            friend bool operator<(const Iterator& lhs, const Iterator& rhs) { return lhs._entry < rhs._entry; }
+            friend bool operator>(const Iterator& lhs, const Iterator& rhs) { return lhs._entry > rhs._entry; }
+            friend bool operator<=(const Iterator& lhs, const Iterator& rhs) { return lhs._entry <= rhs._entry; }
+            friend bool operator>=(const Iterator& lhs, const Iterator& rhs) { return lhs._entry >= rhs._entry; }
+        };
+        using iterator = Iterator<false>;
+        using const_iterator = Iterator<true>;
+
+        explicit RandomDict(typename Engine::result_type seed): v{}, m{}, rng(seed) {}
+        // the dense storage, the values in it and the map nodes all allocate from alloc
+        RandomDict(typename Engine::result_type seed, const Allocator& alloc): v(alloc), m(alloc), rng(seed) {}
         RandomDict() = delete;
 
-        RandomDict(const RandomDict& other): v{}, m{other.m}, rng{other.rng} { align_v(other); }
-        RandomDict(RandomDict&& other) noexcept: v{std::move(other.v)}, m{}, rng(std::move(other.rng)) {
+        RandomDict(const RandomDict& other):
+            v(std::allocator_traits<typename decltype(v)::allocator_type>::select_on_container_copy_construction(
+                    other.v.get_allocator())),
+            m{other.m}, rng{other.rng} { align_v(other); }
+        RandomDict(RandomDict&& other) noexcept: v{std::move(other.v)}, m{other.m.get_allocator()}, rng(std::move(other.rng)) {
             m.merge(std::move(other.m));
+            relink();
         }
 
         RandomDict& operator=(const RandomDict& other) {
@@ -137,33 +479,125 @@ namespace data_structures {
             }
             return *this;
         }
-        RandomDict& operator=(RandomDict&& other) noexcept {
-            if (this!=&other) {
+        // see RandomSet
+        RandomDict& operator=(RandomDict&& other)
+                noexcept(std::allocator_traits<typename map_type::allocator_type>::is_always_equal::value) {
+            if (this!=&other && m.get_allocator() != other.m.get_allocator()) {
+                *this = other;
+                other.clear();
+            } else if (this!=&other) {
                 v = std::move(other.v);
                 rng = std::move(other.rng);
                 m.clear();
                 m.merge(std::move(other.m));
+                relink();
             }
             return *this;
         }
 
+        // lookups by other key types, given transparent Hash and KeyEqual; std::unordered_map needs C++20 for them
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, detail::unordered_heterogeneous>;
+
         auto count(const K& key) const { return m.count(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        auto count(const KT& key) const { return m.count(key); }
         [[nodiscard]] auto size() const noexcept { return v.size(); };
+        [[nodiscard]] allocator_type get_allocator() const noexcept { return allocator_type(v.get_allocator()); }
         void clear() noexcept {
             v.clear();
             m.clear();
         }
 
+        iterator begin() noexcept { return iterator{v.data()}; }
+        iterator end() noexcept { return iterator{v.data() + v.size()}; }
+        const_iterator begin() const noexcept { return const_iterator{v.data()}; }
+        const_iterator end() const noexcept { return const_iterator{v.data() + v.size()}; }
+        const_iterator cbegin() const noexcept { return begin(); }
+        const_iterator cend() const noexcept { return end(); }
+
+        // calls f(key, value) on every entry in storage order: one sequential pass over the dense storage
+        template<typename F>
+        void for_each(F&& f) {
+            for (auto& entry: v) { f(std::as_const(entry.first->first), entry.second); }
+        }
+        template<typename F>
+        void for_each(F&& f) const {
+            for (const auto& entry: v) { f(entry.first->first, entry.second); }
+        }
+
+        // for_each with the dense storage cut into one contiguous chunk per thread; f is called concurrently,
+        // so it must be safe to run on distinct entries at once. for other schedulers (a thread pool,
+        // std::execution::par), split [begin(), end()) instead, the iterators being random-access
+        template<typename F>
+        void parallel_for_each(F&& f, unsigned threads = std::thread::hardware_concurrency()) {
+            detail::parallel_chunks(v.size(), threads, [&](size_type first, size_type last) {
+                for (size_type i = first; i < last; ++i) { f(std::as_const(v[i].first->first), v[i].second); }
+            });
+        }
+        template<typename F>
+        void parallel_for_each(F&& f, unsigned threads = std::thread::hardware_concurrency()) const {
+            detail::parallel_chunks(v.size(), threads, [&](size_type first, size_type last) {
+                for (size_type i = first; i < last; ++i) { f(v[i].first->first, v[i].second); }
+            });
+        }
+
+        // capacity control acts on the dense storage and the map together
+        void reserve(size_type n) {
+            const size_type buckets = m.bucket_count();
+            v.reserve(n);
+            m.reserve(n);
+            relink_if(buckets);
+        }
+        void rehash(size_type bucket_count) {
+            const size_type buckets = m.bucket_count();
+            m.rehash(bucket_count);
+            relink_if(buckets);
+        }
+        [[nodiscard]] size_type bucket_count() const noexcept { return m.bucket_count(); }
+        [[nodiscard]] float load_factor() const noexcept { return m.load_factor(); }
+        [[nodiscard]] float max_load_factor() const noexcept { return m.max_load_factor(); }
+        void max_load_factor(float ml) {
+            const size_type buckets = m.bucket_count();
+            m.max_load_factor(ml);
+            relink_if(buckets);
+        }
+        // gives back what a large purge left behind
+        void shrink_to_fit() {
+            v.shrink_to_fit();
+            rehash(0);  // the fewest buckets that keep the load factor within bounds
+        }
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+        // the counters, plus the current shape of the dense storage and of the map
+        [[nodiscard]] RandomStats stats() const {
+            RandomStats snapshot = _stats;
+            snapshot.size = v.size();
+            snapshot.capacity = v.capacity();
+            snapshot.index = detail::probe_stats(m);
+            return snapshot;
+        }
+        void reset_stats() noexcept { _stats = {}; }
+#endif
+
         V& at(const K& key) { return v.at(m.at(key)).second; }
         const V& at(const K& key) const { return v.at(m.at(key)).second; }
+        template<typename KT, if_lookup<KT> = 0>
+        V& at(const KT& key) { return v[find_or_throw(key)].second; }
+        template<typename KT, if_lookup<KT> = 0>
+        const V& at(const KT& key) const { return v[find_or_throw(key)].second; }
 
         template<typename KT>
         V& operator[](KT&& key) {
             static_assert(std::is_constructible_v<K, decltype(key)>);
+            const size_type buckets = m.bucket_count();
             auto [iter, insertion_happens] = m.emplace(std::forward<KT>(key), v.size());
             if (insertion_happens) {  // V is default-constructed here
-                return v.emplace_back(std::piecewise_construct,
-                                      std::forward_as_tuple(&(iter->first)), std::forward_as_tuple()).second;
+                GSK_STAT(++_stats.inserts);
+                V& val = v.emplace_back(std::piecewise_construct,
+                                        std::forward_as_tuple(iter), std::forward_as_tuple()).second;
+                relink_if(buckets);
+                return val;
             } else {
                 return v.at(iter->second).second;  // ref to existing elem
             }
@@ -173,55 +607,820 @@ namespace data_structures {
         template<typename ...KT, typename ...VT>
         int emplace(std::tuple<KT...> key_args, std::tuple<VT...> val_args) {
             static_assert(std::is_constructible_v<K, KT...> and std::is_constructible_v<V, VT...>);
+            const size_type buckets = m.bucket_count();
             auto [iter, insertion_happens] = m.emplace(std::piecewise_construct,
                                                        std::move(key_args), std::forward_as_tuple(v.size()));
             if (insertion_happens) {
-                v.emplace_back(std::piecewise_construct, std::forward_as_tuple(&(iter->first)), std::move(val_args));
+                v.emplace_back(std::piecewise_construct, std::forward_as_tuple(iter), std::move(val_args));
+                relink_if(buckets);
+                GSK_STAT(++_stats.inserts);
                 return 1;
             } else {
                 return 0;
             }
         }
 
+        // inserts (key, V(args...)) unless key is present, with a single lookup either way; args are left untouched
+        // if it is, so that the caller can assign them through the returned iterator instead
+        template<typename KT, typename ...Args>
+        std::pair<iterator, bool> try_emplace(KT&& key, Args&&... args) {
+            static_assert(std::is_constructible_v<K, decltype(key)> and std::is_constructible_v<V, Args...>);
+            const size_type buckets = m.bucket_count();
+            auto [iter, insertion_happens] = m.try_emplace(std::forward<KT>(key), v.size());
+            if (!insertion_happens) { return {iterator{v.data() + iter->second}, false}; }
+            v.emplace_back(std::piecewise_construct, std::forward_as_tuple(iter),
+                           std::forward_as_tuple(std::forward<Args>(args)...));
+            relink_if(buckets);
+            GSK_STAT(++_stats.inserts);
+            return {iterator{&v.back()}, true};
+        }
+
         template<typename KT, typename VT>
         int insert(KT&& key, VT&& val) noexcept {
             static_assert(std::is_constructible_v<K, decltype(key)> and std::is_constructible_v<V, decltype(val)>);
+            const size_type buckets = m.bucket_count();
+            auto [iter, insertion_happens] = m.emplace(std::forward<KT>(key), v.size());
+            if (insertion_happens) {
+                v.emplace_back(iter, std::forward<VT>(val));
+                relink_if(buckets);
+                GSK_STAT(++_stats.inserts);
+                return 1;
+            } else {
+                return 0;
+            }
+        }
+
+        int erase(const K& key) { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        int erase(const KT& key) {
+            auto iter = m.find(key);
+            if (iter == m.end()) { return 0; }  // no-op if not found
+            size_type index_removed = iter->second;
+            m.erase(iter);
+            fill_hole(index_removed);
+            return 1;
+        }
+
+        // inserts every (key, value) pair in [first, last), keeping existing keys as they are; returns how many were new
+        template<typename InputIt, detail::if_key_range<InputIt, K> = 0>
+        size_type insert(InputIt first, InputIt last) {
+            reserve(v.size() + detail::distance_hint(first, last));
+            size_type inserted = 0;
+            for (; first != last; ++first) {
+                auto&& kv = *first;
+                inserted += insert(kv.first, kv.second);
+            }
+            return inserted;
+        }
+
+        // erases every key in [first, last) and returns how many were present; see RandomSet
+        template<typename InputIt, detail::if_iterator<InputIt> = 0>
+        size_type erase(InputIt first, InputIt last) {
+            std::vector<size_type, detail::rebind_alloc_t<Allocator, size_type>> holes(v.get_allocator());
+            for (; first != last; ++first) {
+                auto iter = m.find(*first);
+                if (iter == m.end()) { continue; }
+                holes.push_back(iter->second);
+                m.erase(iter);
+            }
+            std::sort(holes.begin(), holes.end(), std::greater<>());
+            for (size_type idx: holes) { fill_hole(idx); }
+            return holes.size();
+        }
+
+        // removes and returns a uniformly random (key, value) pair, moved rather than copied; as in RandomSet,
+        // the node is unlinked through its iterator and no key is hashed
+        std::pair<K, V> pop_random() {
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            return pop_at(detail::bounded(rng, v.size()));
+        }
+        // the same, drawn from every entry but keep (e.g. the one just inserted); there must be another
+        std::pair<K, V> pop_random_except(const_iterator keep) {
+            if (v.size() < 2) { throw std::runtime_error("empty dictionary"); }
+            const auto kept = static_cast<size_type>(keep - cbegin());
+            const size_type idx = detail::bounded(rng, v.size() - 1);
+            return pop_at(idx < kept ? idx : idx + 1);
+        }
+
+        std::pair<const K&, const V&> random_pair() const {
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            GSK_STAT(++_stats.draws);
+            auto it = std::next(v.begin(), detail::bounded(rng, v.size()));
+            return {std::cref(it->first->first), std::cref(it->second)};
+        }
+
+        std::pair<const K&, V&> random_pair() {
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            GSK_STAT(++_stats.draws);
+            auto it = std::next(v.begin(), detail::bounded(rng, v.size()));
+            return {std::cref(it->first->first), std::ref(it->second)};
+        }
+
+        // writes k (key, value) pairs drawn with replacement to out, as std::pair<const K&, const V&>
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            if (k == 0) { return out; }
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            GSK_STAT(_stats.draws += k);
+            detail::sample_indices(v.size(), k, rng, [&](size_type i) {
+                *out = std::pair<const K&, const V&>{v[i].first->first, v[i].second};
+                ++out;
+            });
+            return out;
+        }
+
+        // writes min(k, size()) distinct (key, value) pairs to out, in no particular order
+        template<typename OutputIt>
+        OutputIt sample_distinct(size_type k, OutputIt out) const {
+            GSK_STAT(_stats.draws += std::min(k, v.size()));
+            detail::sample_distinct_indices(v.size(), k, rng, [&](size_type i) {
+                *out = std::pair<const K&, const V&>{v[i].first->first, v[i].second};
+                ++out;
+            });
+            return out;
+        }
+    };
+}
+
+namespace data_structures::detail {
+    // a Fenwick (binary indexed) tree of non-negative weights that grows and shrinks at the back
+    class FenwickTree {
+    private:
+        std::vector<double> tree;  // tree[j-1] sums the weights in (j - lowbit(j), j]
+        using size_type = std::vector<double>::size_type;
+        static size_type lowbit(size_type j) { return j & (~j + 1); }
+    public:
+        [[nodiscard]] size_type size() const noexcept { return tree.size(); }
+        void clear() noexcept { tree.clear(); }
+        void reserve(size_type n) { tree.reserve(n); }
+        void shrink_to_fit() { tree.shrink_to_fit(); }
+
+        // sum of the first n weights
+        [[nodiscard]] double prefix(size_type n) const {
+            double sum = 0;
+            for (; n > 0; n -= lowbit(n)) { sum += tree[n - 1]; }
+            return sum;
+        }
+        [[nodiscard]] double total() const { return prefix(tree.size()); }
+
+        void add(size_type i, double delta) {
+            for (size_type j = i + 1; j <= tree.size(); j += lowbit(j)) { tree[j - 1] += delta; }
+        }
+        void push_back(double weight) {
+            const size_type j = tree.size() + 1;
+            tree.push_back(weight + prefix(j - 1) - prefix(j - lowbit(j)));
+        }
+        void pop_back() { tree.pop_back(); }  // no other node covers the last weight
+        // rebuilds the tree over weights in O(n), discarding the rounding error that add accumulates
+        void assign(const std::vector<double>& weights) {
+            tree = weights;
+            for (size_type j = 1; j <= tree.size(); ++j) {
+                const size_type parent = j + lowbit(j);
+                if (parent <= tree.size()) { tree[parent - 1] += tree[j - 1]; }
+            }
+        }
+
+        // the first index whose prefix sum exceeds u, for u in [0, total())
+        [[nodiscard]] size_type find(double u) const {
+            size_type pos = 0;
+            size_type step = 1;
+            while (step * 2 <= tree.size()) { step *= 2; }
+            for (; step > 0; step /= 2) {
+                if (pos + step <= tree.size() && tree[pos + step - 1] <= u) {
+                    u -= tree[pos + step - 1];
+                    pos += step;
+                }
+            }
+            return std::min(pos, tree.size() - 1);  // rounding might push u past the total
+        }
+    };
+}
+
+namespace data_structures {
+    // RandomDict whose random_pair picks each entry with probability proportional to its weight
+    // weights live in a Fenwick tree over the dense vector, so that updates, insert, erase
+    // (still swap-with-last) and weighted sampling are all O(log n)
+    template<typename K, typename V,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937>
+    class WeightedRandomDict {
+    static_assert(std::is_default_constructible_v<V>, "the mapped type, V, should be default constructible");
+    private:
+        using map_type = std::unordered_map<K, std::size_t, Hash, KeyEqual>;
+        std::vector<std::pair<typename map_type::iterator, V>> v;  // iterators to nodes of m; see RandomSet
+        using size_type = typename decltype(v)::size_type;
+        std::vector<double> w;  // w[i] is the weight of v[i]
+        detail::FenwickTree tree;
+        size_type positive{};  // entries of non-zero weight, counted exactly from w
+        size_type deltas{};  // weight changes added to tree since it was last rebuilt from w
+        static constexpr size_type min_rebuild = 64;
+        map_type m;
+        mutable Engine rng;
+    private:
+        void relink() {  // see RandomSet
+            for (auto it = m.begin(); it != m.end(); ++it) { v[it->second].first = it; }
+        }
+        void relink_if(size_type buckets) {
+            if (m.bucket_count() != buckets) { relink(); }
+        }
+        void align_v(const WeightedRandomDict& other) {
+            v.clear();
+            v.resize(m.size());
+            for (auto it = m.begin(); it != m.end(); ++it) {
+                v[it->second] = std::make_pair(it, other.v[it->second].second);
+            }
+        }
+        void fill_hole(size_type idx) {  // see RandomSet; the weights follow their entries
+            positive -= w[idx] > 0;
+            if (idx != v.size() - 1) {
+                v[idx] = std::move(v.back());
+                v[idx].first->second = idx;
+                tree.add(idx, w.back() - w[idx]);
+                w[idx] = w.back();
+                ++deltas;
+            }
+            v.pop_back();
+            w.pop_back();
+            tree.pop_back();
+            bound_drift();
+        }
+        // every add rounds, and the errors pile up in the tree: after as many deltas as there are entries
+        // (O(1) amortised per delta) the tree is rebuilt from w, which holds the weights exactly
+        void bound_drift() {
+            if (deltas >= std::max(min_rebuild, w.size())) {
+                tree.assign(w);
+                deltas = 0;
+            }
+        }
+        static void check_weight(double weight) {
+            if (!(weight >= 0) || weight == std::numeric_limits<double>::infinity()) {
+                throw std::invalid_argument("weights should be finite and non-negative");
+            }
+        }
+        [[nodiscard]] size_type weighted_index() const {
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            if (!positive) { throw std::runtime_error("all weights are zero"); }
+            size_type idx = tree.find(detail::unit_real(rng) * std::max(tree.total(), 0.0));
+            // rounding may end the descent on a zero weight next to a boundary; the entry beyond the run of
+            // zeros is the one the exact sums would pick, or the one before it at the very end
+            if (!(w[idx] > 0)) {
+                size_type j = idx;
+                while (j < w.size() && !(w[j] > 0)) { ++j; }
+                if (j == w.size()) {
+                    for (j = idx; !(w[j] > 0); --j) {}  // positive says there is one
+                }
+                idx = j;
+            }
+            return idx;
+        }
+        template<typename KT>
+        size_type find_or_throw(const KT& key) const {  // m.at takes no other key types
+            auto it = m.find(key);
+            if (it == m.end()) { throw std::out_of_range("key not found"); }
+            return it->second;
+        }
+    public:
+        explicit WeightedRandomDict(typename Engine::result_type seed): v{}, w{}, tree{}, m{}, rng(seed) {}
+        WeightedRandomDict() = delete;
+
+        WeightedRandomDict(const WeightedRandomDict& other):
+            v{}, w{other.w}, tree{other.tree}, positive{other.positive}, deltas{other.deltas}, m{other.m}, rng{other.rng} {
+            align_v(other);
+        }
+        WeightedRandomDict(WeightedRandomDict&& other) noexcept:
+            v{std::move(other.v)}, w{std::move(other.w)}, tree{std::move(other.tree)}, positive{other.positive},
+            deltas{other.deltas}, m{}, rng{std::move(other.rng)} {
+            m.merge(std::move(other.m));
+            relink();
+            other.positive = other.deltas = 0;
+        }
+
+        WeightedRandomDict& operator=(const WeightedRandomDict& other) {
+            if (this!=&other) {
+                m = other.m;
+                w = other.w;
+                tree = other.tree;
+                positive = other.positive;
+                deltas = other.deltas;
+                rng = other.rng;
+                align_v(other);
+            }
+            return *this;
+        }
+        WeightedRandomDict& operator=(WeightedRandomDict&& other) noexcept {
+            if (this!=&other) {
+                v = std::move(other.v);
+                w = std::move(other.w);
+                tree = std::move(other.tree);
+                positive = other.positive;
+                deltas = other.deltas;
+                other.positive = other.deltas = 0;
+                rng = std::move(other.rng);
+                m.clear();
+                m.merge(std::move(other.m));
+                relink();
+            }
+            return *this;
+        }
+
+        // lookups by other key types, given transparent Hash and KeyEqual; std::unordered_map needs C++20 for them
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, detail::unordered_heterogeneous>;
+
+        auto count(const K& key) const { return m.count(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        auto count(const KT& key) const { return m.count(key); }
+        [[nodiscard]] auto size() const noexcept { return v.size(); }
+        void clear() noexcept {
+            v.clear();
+            w.clear();
+            tree.clear();
+            positive = deltas = 0;
+            m.clear();
+        }
+
+        // capacity control acts on the dense storage and the map together
+        void reserve(size_type n) {
+            const size_type buckets = m.bucket_count();
+            v.reserve(n);
+            w.reserve(n);
+            tree.reserve(n);
+            m.reserve(n);
+            relink_if(buckets);
+        }
+        void rehash(size_type bucket_count) {
+            const size_type buckets = m.bucket_count();
+            m.rehash(bucket_count);
+            relink_if(buckets);
+        }
+        [[nodiscard]] size_type bucket_count() const noexcept { return m.bucket_count(); }
+        [[nodiscard]] float load_factor() const noexcept { return m.load_factor(); }
+        [[nodiscard]] float max_load_factor() const noexcept { return m.max_load_factor(); }
+        void max_load_factor(float ml) {
+            const size_type buckets = m.bucket_count();
+            m.max_load_factor(ml);
+            relink_if(buckets);
+        }
+        // gives back what a large purge left behind
+        void shrink_to_fit() {
+            v.shrink_to_fit();
+            w.shrink_to_fit();
+            tree.shrink_to_fit();
+            rehash(0);  // the fewest buckets that keep the load factor within bounds
+        }
+
+        V& at(const K& key) { return v[m.at(key)].second; }
+        const V& at(const K& key) const { return v[m.at(key)].second; }
+        template<typename KT, if_lookup<KT> = 0>
+        V& at(const KT& key) { return v[find_or_throw(key)].second; }
+        template<typename KT, if_lookup<KT> = 0>
+        const V& at(const KT& key) const { return v[find_or_throw(key)].second; }
+
+        [[nodiscard]] double weight(const K& key) const { return w[m.at(key)]; }
+        template<typename KT, if_lookup<KT> = 0>
+        [[nodiscard]] double weight(const KT& key) const { return w[find_or_throw(key)]; }
+        void set_weight(const K& key, double weight) { set_weight<K>(key, weight); }
+        template<typename KT, if_lookup<KT> = 0>
+        void set_weight(const KT& key, double weight) {
+            check_weight(weight);
+            const size_type idx = find_or_throw(key);
+            if (w[idx] > 0) { --positive; }
+            if (weight > 0) { ++positive; }
+            tree.add(idx, weight - w[idx]);
+            w[idx] = weight;
+            ++deltas;
+            bound_drift();
+        }
+        // the tree's sum, so within rounding of the weights'; exactly 0 when every weight is
+        [[nodiscard]] double total_weight() const { return positive ? tree.total() : 0.0; }
+
+        // use piecewise as a separator for two variadic params
+        template<typename ...KT, typename ...VT>
+        int emplace(std::tuple<KT...> key_args, std::tuple<VT...> val_args, double weight) {
+            static_assert(std::is_constructible_v<K, KT...> and std::is_constructible_v<V, VT...>);
+            check_weight(weight);
+            const size_type buckets = m.bucket_count();
+            auto [iter, insertion_happens] = m.emplace(std::piecewise_construct,
+                                                       std::move(key_args), std::forward_as_tuple(v.size()));
+            if (insertion_happens) {
+                v.emplace_back(std::piecewise_construct, std::forward_as_tuple(iter), std::move(val_args));
+                relink_if(buckets);
+                w.push_back(weight);
+                tree.push_back(weight);
+                positive += weight > 0;
+                return 1;
+            } else {
+                return 0;
+            }
+        }
+
+        template<typename KT, typename VT>
+        int insert(KT&& key, VT&& val, double weight) {
+            static_assert(std::is_constructible_v<K, decltype(key)> and std::is_constructible_v<V, decltype(val)>);
+            check_weight(weight);
+            const size_type buckets = m.bucket_count();
             auto [iter, insertion_happens] = m.emplace(std::forward<KT>(key), v.size());
             if (insertion_happens) {
-                v.emplace_back(&(iter->first), std::forward<VT>(val));
+                v.emplace_back(iter, std::forward<VT>(val));
+                relink_if(buckets);
+                w.push_back(weight);
+                tree.push_back(weight);
+                positive += weight > 0;
                 return 1;
             } else {
                 return 0;
             }
         }
 
-        int erase(const K& key) {
+        int erase(const K& key) { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        int erase(const KT& key) {
             auto iter = m.find(key);
             if (iter == m.end()) { return 0; }  // no-op if not found
             size_type index_removed = iter->second;
             m.erase(iter);
-            if (index_removed != v.size() - 1) { // not the last entry
-                v.at(index_removed) = std::move(v.back());  // redirect v
-                m.at(*(v.at(index_removed).first)) = index_removed;  // redirect m
+            fill_hole(index_removed);
+            return 1;
+        }
+
+        std::pair<const K&, const V&> random_pair() const {
+            const auto& [node, val] = v[weighted_index()];
+            return {node->first, val};
+        }
+
+        std::pair<const K&, V&> random_pair() {
+            auto& [node, val] = v[weighted_index()];
+            return {node->first, val};
+        }
+
+        // removes and returns a (key, value) pair picked by weight, i.e. weighted sampling without replacement
+        std::pair<K, V> pop_random() {
+            const size_type idx = weighted_index();
+            V val = std::move(v[idx].second);
+            auto node = m.extract(v[idx].first);
+            fill_hole(idx);
+            return {std::move(node.key()), std::move(val)};
+        }
+    };
+}
+
+namespace data_structures {
+    // RandomSet with the keys stored by value in the dense vector and only their indices in an open-addressing table:
+    // sampling reads one contiguous array, and erase probes once, since the table remembers where each index is
+    // unlike RandomSet, references to keys are invalidated by insert and erase
+    // both arrays are chunked and copy-on-write: copies (see snapshot) share every chunk neither side has written to
+    template<typename K,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937>
+    class FlatRandomSet {
+    private:
+        detail::CowVector<K> v;
+        using size_type = typename decltype(v)::size_type;
+        detail::DenseIndex<Hash, KeyEqual> index;
+        mutable Engine rng;
+    private:
+        auto key_at() const { return [this](size_type idx) -> const K& { return v[idx]; }; }
+        static FlatRandomSet from_image(detail::ImageReader reader, typename Engine::result_type seed) {
+            FlatRandomSet loaded{seed};
+            const detail::ImageHeader header = detail::load_image(reader, loaded.v, loaded.index);
+            if (header.size && loaded.index.hash_of(loaded.key_at()(0)) != header.hash_check) {
+                throw std::runtime_error("image: saved with a different Hash");
+            }
+            return loaded;
+        }
+    public:
+        explicit FlatRandomSet(typename Engine::result_type seed): v{}, index{}, rng(seed) {}
+        FlatRandomSet() = delete;
+
+        // a copy that shares storage with this one, in O(size() / chunk size); writes to either side
+        // unshare only the chunks they touch, so a writer may keep going while readers use the snapshot
+        [[nodiscard]] FlatRandomSet snapshot() const { return *this; }
+
+        // images: save writes the dense array and the index table as they are, and load or map rebuild the
+        // container from them without hashing or copying a single element; map reads the file through a
+        // read-only mapping, so nothing is read up front and chunks are copied on their first write
+        // elements must be trivially copyable, and the loading program must use the same types and Hash
+        void save(std::ostream& out) const {
+            detail::save_image(out, v, index, v.empty() ? 0 : index.hash_of(key_at()(0)));
+        }
+        static FlatRandomSet load(std::istream& in, typename Engine::result_type seed) {
+            std::size_t bytes{};
+            auto image = detail::read_image(in, bytes);
+            return from_image(detail::ImageReader{image.get(), bytes, image}, seed);
+        }
+        static FlatRandomSet map(const std::string& path, typename Engine::result_type seed) {
+            std::size_t bytes{};
+            auto image = detail::map_image(path, bytes);
+            return from_image(detail::ImageReader{image.get(), bytes, image}, seed);
+        }
+
+        // lookups by other key types, given transparent Hash and KeyEqual
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, true>;
+
+        auto count(const K& key) const { return count<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        auto count(const KT& key) const { return index.find(key, key_at()) == index.npos ? 0 : 1; }
+        [[nodiscard]] auto size() const noexcept { return v.size(); }
+        void clear() noexcept {
+            v.clear();
+            index.clear();
+        }
+
+        void reserve(size_type n) {
+            v.reserve(n);
+            index.reserve(n, key_at());
+        }
+
+        template<typename ...KT>
+        int insert(KT&&... key) {
+            static_assert(std::is_constructible_v<K, KT...>);
+            K k(std::forward<KT>(key)...);
+            if (index.find(k, key_at()) != index.npos) { return 0; }  // value already exists -> no-op
+            v.push_back(std::move(k));
+            try {
+                index.push_back(key_at());
+            } catch (...) {
+                v.pop_back();
+                throw;
+            }
+            return 1;
+        }
+
+        int erase(const K& key) { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        int erase(const KT& key) {
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { return 0; }  // no-op if not found
+            const size_type index_removed = index.remove(slot);  // the only probe
+            if (index_removed != v.size() - 1) {
+                v[index_removed] = std::move(v.back());
+            }
+            v.pop_back();
+            return 1;
+        }
+
+        // see RandomSet; the table already knows v[i]'s slot, so no key is hashed or compared
+        template<typename InputIt, detail::if_key_range<InputIt, K> = 0>
+        size_type insert(InputIt first, InputIt last) {
+            reserve(v.size() + detail::distance_hint(first, last));
+            size_type inserted = 0;
+            for (; first != last; ++first) { inserted += insert(*first); }
+            return inserted;
+        }
+        template<typename InputIt, detail::if_iterator<InputIt> = 0>
+        size_type erase(InputIt first, InputIt last) {
+            size_type erased = 0;
+            for (; first != last; ++first) { erased += erase(*first); }
+            return erased;
+        }
+
+        K pop_random() {
+            if (v.empty()) { throw std::runtime_error("empty set"); }
+            const size_type idx = index.remove(index.slot_of(detail::bounded(rng, v.size())));
+            K key = std::move(v[idx]);
+            if (idx != v.size() - 1) {
+                v[idx] = std::move(v.back());
+            }
+            v.pop_back();
+            return key;
+        }
+
+        const K& random_elem() const {
+            if (v.empty()) { throw std::runtime_error("empty set"); }
+            return v[detail::bounded(rng, v.size())];
+        }
+
+        // writes k keys drawn with replacement to out
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            if (k == 0) { return out; }
+            if (v.empty()) { throw std::runtime_error("empty set"); }
+            detail::sample_indices(v.size(), k, rng, [&](size_type i) { *out = v[i]; ++out; });
+            return out;
+        }
+
+        // writes min(k, size()) distinct keys to out, in no particular order
+        template<typename OutputIt>
+        OutputIt sample_distinct(size_type k, OutputIt out) const {
+            detail::sample_distinct_indices(v.size(), k, rng, [&](size_type i) { *out = v[i]; ++out; });
+            return out;
+        }
+    };
+}
+
+namespace data_structures {
+    // RandomDict with the (key, value) pairs stored by value in the dense vector; see FlatRandomSet
+    template<typename K, typename V,
+            typename Hash=std::hash<K>,
+            typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937>
+    class FlatRandomDict {
+    static_assert(std::is_default_constructible_v<V>, "the mapped type, V, should be default constructible");
+    private:
+        detail::CowVector<std::pair<K, V>> v;
+        using size_type = typename decltype(v)::size_type;
+        detail::DenseIndex<Hash, KeyEqual> index;
+        mutable Engine rng;
+    private:
+        auto key_at() const { return [this](size_type idx) -> const K& { return v[idx].first; }; }
+        template<typename ...Arg>
+        void append(Arg&&... args) {  // the key must be absent
+            v.emplace_back(std::forward<Arg>(args)...);
+            try {
+                index.push_back(key_at());
+            } catch (...) {
+                v.pop_back();
+                throw;
+            }
+        }
+        static FlatRandomDict from_image(detail::ImageReader reader, typename Engine::result_type seed) {
+            FlatRandomDict loaded{seed};
+            const detail::ImageHeader header = detail::load_image(reader, loaded.v, loaded.index);
+            if (header.size && loaded.index.hash_of(loaded.key_at()(0)) != header.hash_check) {
+                throw std::runtime_error("image: saved with a different Hash");
+            }
+            return loaded;
+        }
+    public:
+        explicit FlatRandomDict(typename Engine::result_type seed): v{}, index{}, rng(seed) {}
+        FlatRandomDict() = delete;
+
+        // a copy that shares storage with this one, in O(size() / chunk size); writes to either side
+        // unshare only the chunks they touch, so a writer may keep going while readers use the snapshot
+        [[nodiscard]] FlatRandomDict snapshot() const { return *this; }
+
+        // images: save writes the dense array and the index table as they are, and load or map rebuild the
+        // container from them without hashing or copying a single element; map reads the file through a
+        // read-only mapping, so nothing is read up front and chunks are copied on their first write
+        // elements must be trivially copyable, and the loading program must use the same types and Hash
+        void save(std::ostream& out) const {
+            detail::save_image(out, v, index, v.empty() ? 0 : index.hash_of(key_at()(0)));
+        }
+        static FlatRandomDict load(std::istream& in, typename Engine::result_type seed) {
+            std::size_t bytes{};
+            auto image = detail::read_image(in, bytes);
+            return from_image(detail::ImageReader{image.get(), bytes, image}, seed);
+        }
+        static FlatRandomDict map(const std::string& path, typename Engine::result_type seed) {
+            std::size_t bytes{};
+            auto image = detail::map_image(path, bytes);
+            return from_image(detail::ImageReader{image.get(), bytes, image}, seed);
+        }
+
+        // lookups by other key types, given transparent Hash and KeyEqual
+        template<typename KT>
+        using if_lookup = detail::enable_lookup_t<KT, K, Hash, KeyEqual, true>;
+
+        auto count(const K& key) const { return count<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        auto count(const KT& key) const { return index.find(key, key_at()) == index.npos ? 0 : 1; }
+        [[nodiscard]] auto size() const noexcept { return v.size(); }
+        void clear() noexcept {
+            v.clear();
+            index.clear();
+        }
+
+        void reserve(size_type n) {
+            v.reserve(n);
+            index.reserve(n, key_at());
+        }
+
+        V& at(const K& key) { return at<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        V& at(const KT& key) {
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { throw std::out_of_range("FlatRandomDict::at"); }
+            return v[index.index_at(slot)].second;
+        }
+        const V& at(const K& key) const { return at<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        const V& at(const KT& key) const {
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { throw std::out_of_range("FlatRandomDict::at"); }
+            return v[index.index_at(slot)].second;
+        }
+
+        template<typename KT>
+        V& operator[](KT&& key) {
+            static_assert(std::is_constructible_v<K, decltype(key)>);
+            K k(std::forward<KT>(key));
+            const size_type slot = index.find(k, key_at());
+            if (slot != index.npos) { return v[index.index_at(slot)].second; }  // ref to existing elem
+            append(std::piecewise_construct, std::forward_as_tuple(std::move(k)), std::forward_as_tuple());
+            return v.back().second;
+        }
+
+        // use piecewise as a separator for two variadic params
+        template<typename ...KT, typename ...VT>
+        int emplace(std::tuple<KT...> key_args, std::tuple<VT...> val_args) {
+            static_assert(std::is_constructible_v<K, KT...> and std::is_constructible_v<V, VT...>);
+            K k = std::make_from_tuple<K>(std::move(key_args));
+            if (index.find(k, key_at()) != index.npos) { return 0; }
+            append(std::piecewise_construct, std::forward_as_tuple(std::move(k)), std::move(val_args));
+            return 1;
+        }
+
+        template<typename KT, typename VT>
+        int insert(KT&& key, VT&& val) {
+            static_assert(std::is_constructible_v<K, decltype(key)> and std::is_constructible_v<V, decltype(val)>);
+            K k(std::forward<KT>(key));
+            if (index.find(k, key_at()) != index.npos) { return 0; }
+            append(std::move(k), std::forward<VT>(val));
+            return 1;
+        }
+
+        int erase(const K& key) { return erase<K>(key); }
+        template<typename KT, if_lookup<KT> = 0>
+        int erase(const KT& key) {
+            const size_type slot = index.find(key, key_at());
+            if (slot == index.npos) { return 0; }  // no-op if not found
+            const size_type index_removed = index.remove(slot);  // the only probe
+            if (index_removed != v.size() - 1) {
+                v[index_removed] = std::move(v.back());
             }
-            v.pop_back();  // shrink the last entry out
+            v.pop_back();
             return 1;
         }
 
+        // see RandomDict and FlatRandomSet
+        template<typename InputIt, detail::if_key_range<InputIt, K> = 0>
+        size_type insert(InputIt first, InputIt last) {
+            reserve(v.size() + detail::distance_hint(first, last));
+            size_type inserted = 0;
+            for (; first != last; ++first) {
+                auto&& kv = *first;
+                inserted += insert(kv.first, kv.second);
+            }
+            return inserted;
+        }
+        template<typename InputIt, detail::if_iterator<InputIt> = 0>
+        size_type erase(InputIt first, InputIt last) {
+            size_type erased = 0;
+            for (; first != last; ++first) { erased += erase(*first); }
+            return erased;
+        }
+
+        std::pair<K, V> pop_random() {
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            const size_type idx = index.remove(index.slot_of(detail::bounded(rng, v.size())));
+            std::pair<K, V> popped = std::move(v[idx]);
+            if (idx != v.size() - 1) {
+                v[idx] = std::move(v.back());
+            }
+            v.pop_back();
+            return popped;
+        }
+
         std::pair<const K&, const V&> random_pair() const {
             if (v.empty()) { throw std::runtime_error("empty dictionary"); }
-            std::uniform_int_distribution<size_type> uniform_distrib(0, v.size() - 1);
-            auto it = std::next(v.begin(), uniform_distrib(rng));
-            return {std::cref(*(it->first)), std::cref(it->second)};
+            const auto& [key, val] = v[detail::bounded(rng, v.size())];
+            return {key, val};
         }
 
         std::pair<const K&, V&> random_pair() {
             if (v.empty()) { throw std::runtime_error("empty dictionary"); }
-            std::uniform_int_distribution<size_type> uniform_distrib(0, v.size() - 1);
-            auto it = std::next(v.begin(), uniform_distrib(rng));
-            return {std::cref(*(it->first)), std::ref(it->second)};
+            auto& [key, val] = v[detail::bounded(rng, v.size())];
+            return {key, val};
+        }
+
+        // writes k (key, value) pairs drawn with replacement to out, as std::pair<const K&, const V&>
+        template<typename OutputIt>
+        OutputIt sample(size_type k, OutputIt out) const {
+            if (k == 0) { return out; }
+            if (v.empty()) { throw std::runtime_error("empty dictionary"); }
+            detail::sample_indices(v.size(), k, rng, [&](size_type i) {
+                *out = std::pair<const K&, const V&>{v[i].first, v[i].second};
+                ++out;
+            });
+            return out;
+        }
+
+        // writes min(k, size()) distinct (key, value) pairs to out, in no particular order
+        template<typename OutputIt>
+        OutputIt sample_distinct(size_type k, OutputIt out) const {
+            detail::sample_distinct_indices(v.size(), k, rng, [&](size_type i) {
+                *out = std::pair<const K&, const V&>{v[i].first, v[i].second};
+                ++out;
+            });
+            return out;
         }
     };
 }
 
+#ifdef __cpp_lib_memory_resource
+namespace data_structures::pmr {
+    // the node-based random containers on a std::pmr::memory_resource, e.g. pmr::RandomSet<int> s{seed, &arena}
+    template<typename K, typename Hash=std::hash<K>, typename KeyEqual=std::equal_to<K>, typename Engine=std::mt19937>
+    using RandomSet = data_structures::RandomSet<K, Hash, KeyEqual, Engine, std::pmr::polymorphic_allocator<K>>;
+
+    template<typename K, typename V, typename Hash=std::hash<K>, typename KeyEqual=std::equal_to<K>,
+            typename Engine=std::mt19937>
+    using RandomDict = data_structures::RandomDict<K, V, Hash, KeyEqual, Engine,
+            std::pmr::polymorphic_allocator<std::pair<const K, V>>>;
+}
+#endif
+
 #endif //GSK_RANDOMDICT_H
@@ -0,0 +1,128 @@
+#ifndef GSK_RANDOMENGINE_H
+#define GSK_RANDOMENGINE_H
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+
+namespace data_structures {
+    // small-state engines satisfying UniformRandomBitGenerator
+    // both are fully specified, so a given seed yields the same stream on every platform
+
+    // splitmix64 (Steele, Lea & Flood); 8 bytes of state
+    class SplitMix64 {
+    private:
+        uint64_t state;
+    public:
+        using result_type = uint64_t;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        explicit SplitMix64(uint64_t seed = 0) noexcept: state{seed} {}
+        void seed(uint64_t s) noexcept { state = s; }
+
+        result_type operator()() noexcept {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31U);
+        }
+
+        friend bool operator==(const SplitMix64& a, const SplitMix64& b) { return a.state == b.state; }
+        friend bool operator!=(const SplitMix64& a, const SplitMix64& b) { return !(a == b); }
+    };
+
+    // xoshiro256++ (Blackman & Vigna); 32 bytes of state, seeded through splitmix64
+    class Xoshiro256PlusPlus {
+    private:
+        uint64_t s[4];
+        static constexpr uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+    public:
+        using result_type = uint64_t;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+        explicit Xoshiro256PlusPlus(uint64_t seed = 0) noexcept: s{} { this->seed(seed); }
+        void seed(uint64_t seed) noexcept {
+            SplitMix64 sm{seed};
+            for (auto& word: s) { word = sm(); }
+        }
+
+        result_type operator()() noexcept {
+            const uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+            const uint64_t t = s[1] << 17U;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= t;
+            s[3] = rotl(s[3], 45);
+            return result;
+        }
+
+        friend bool operator==(const Xoshiro256PlusPlus& a, const Xoshiro256PlusPlus& b) {
+            return a.s[0] == b.s[0] && a.s[1] == b.s[1] && a.s[2] == b.s[2] && a.s[3] == b.s[3];
+        }
+        friend bool operator!=(const Xoshiro256PlusPlus& a, const Xoshiro256PlusPlus& b) { return !(a == b); }
+    };
+}
+
+namespace data_structures::detail {
+    // 64 random bits out of any engine
+    // engines with a full 32- or 64-bit range (mt19937, mt19937_64 and the ones above) are used bit for bit,
+    // which keeps the containers' choices reproducible across standard libraries;
+    // anything else goes through the (implementation-defined) standard distribution
+    template<typename Rng>
+    uint64_t random_bits(Rng& rng) {
+        using result_type = typename Rng::result_type;
+        if constexpr (Rng::min() == 0 && Rng::max() == std::numeric_limits<uint64_t>::max()) {
+            return static_cast<uint64_t>(rng());
+        } else if constexpr (Rng::min() == 0 && Rng::max() == std::numeric_limits<uint32_t>::max()) {
+            const uint64_t hi = static_cast<uint32_t>(rng());
+            return (hi << 32U) | static_cast<uint32_t>(rng());
+        } else {
+            static_assert(std::is_unsigned_v<result_type>, "engines should produce unsigned integers");
+            return std::uniform_int_distribution<uint64_t>{}(rng);
+        }
+    }
+
+    // full 128-bit product of a and b; returns the high half and stores the low one
+    inline uint64_t mul_wide(uint64_t a, uint64_t b, uint64_t& lo) {
+#ifdef __SIZEOF_INT128__
+        const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+        lo = static_cast<uint64_t>(product);
+        return static_cast<uint64_t>(product >> 64U);
+#else
+        const uint64_t a_lo = a & 0xffffffffULL, a_hi = a >> 32U;
+        const uint64_t b_lo = b & 0xffffffffULL, b_hi = b >> 32U;
+        const uint64_t ll = a_lo * b_lo, lh = a_lo * b_hi, hl = a_hi * b_lo, hh = a_hi * b_hi;
+        const uint64_t mid = (ll >> 32U) + (lh & 0xffffffffULL) + (hl & 0xffffffffULL);
+        lo = (mid << 32U) | (ll & 0xffffffffULL);
+        return hh + (lh >> 32U) + (hl >> 32U) + (mid >> 32U);
+#endif
+    }
+
+    // uniform integer in [0, n) by Lemire's nearly-divisionless multiply-shift; n must be positive
+    // the modulo only runs when the first draw lands in the biased sliver of width 2^64 mod n
+    template<typename Rng>
+    uint64_t bounded(Rng& rng, uint64_t n) {
+        uint64_t lo;
+        uint64_t hi = mul_wide(random_bits(rng), n, lo);
+        if (lo < n) {
+            const uint64_t threshold = (0 - n) % n;
+            while (lo < threshold) {
+                hi = mul_wide(random_bits(rng), n, lo);
+            }
+        }
+        return hi;
+    }
+
+    // uniform double in [0, 1) with 53 random bits
+    template<typename Rng>
+    double unit_real(Rng& rng) {
+        return static_cast<double>(random_bits(rng) >> 11U) * 0x1.0p-53;
+    }
+}
+
+#endif //GSK_RANDOMENGINE_H
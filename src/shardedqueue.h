@@ -0,0 +1,145 @@
+#ifndef GSK_SHARDEDQUEUE_H
+#define GSK_SHARDEDQUEUE_H
+
+#include "hashqueue.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+
+namespace data_structures {
+    // a thread-safe timer queue: IDs are partitioned by Hash across independently locked EagerQueue shards,
+    // so threads working on different IDs rarely contend
+    // there is no global order across shards except through pop_until, which merges the due entries of all shards
+    template<typename T, typename ID=T, typename Hash=std::hash<ID>, typename KeyEqual=std::equal_to<ID>,
+            std::size_t Arity=2, typename Priority=double, typename Compare=std::less<Priority>,
+            typename IdOf=DynamicIdOf<T, ID>, typename Index=NodeIndex>
+    class ShardedQueue {
+    public:
+        using queue_type = EagerQueue<T, ID, Hash, KeyEqual, Arity, Priority, Compare, IdOf, Index>;
+        using priority_type = Priority;
+    private:
+        struct alignas(64) Shard {  // one cache line at least, to keep the locks from false sharing
+            std::mutex mutex;
+            queue_type queue;
+            Shard() = default;
+            explicit Shard(const IdOf& id_of): queue{id_of} {}
+        };
+        std::vector<std::unique_ptr<Shard>> _shards;
+        Hash _hash;
+        IdOf _id_of;
+        Compare _cmp;
+        using size_type = typename std::vector<std::unique_ptr<Shard>>::size_type;
+    private:
+        Shard& shard_of(const ID& id) const { return *_shards[_hash(id) % _shards.size()]; }
+        static size_type default_shards() {
+            return std::max<size_type>(1, std::thread::hardware_concurrency());
+        }
+    public:
+        explicit ShardedQueue(size_type num_shards = default_shards()) {
+            for (size_type i = 0; i < std::max<size_type>(1, num_shards); ++i) {
+                _shards.push_back(std::make_unique<Shard>());
+            }
+        }
+
+        template<typename F>
+        ShardedQueue(size_type num_shards, F f): _id_of(std::move(f)) {
+            for (size_type i = 0; i < std::max<size_type>(1, num_shards); ++i) {
+                _shards.push_back(std::make_unique<Shard>(_id_of));
+            }
+        }
+
+        ShardedQueue(const ShardedQueue& other) = delete;
+        ShardedQueue(ShardedQueue&& other) = delete;
+        ShardedQueue& operator=(const ShardedQueue& other) = delete;
+        ShardedQueue& operator=(ShardedQueue&& other) = delete;
+        ~ShardedQueue() = default;
+
+        // the payload is built outside of any lock, since its ID decides the shard
+        template<typename ...Arg>
+        void push(Priority time, Arg&&... args) {
+            T payload(std::forward<Arg>(args)...);
+            Shard& shard = shard_of(_id_of(payload));
+            std::lock_guard lock{shard.mutex};
+            shard.queue.push(std::move(time), std::move(payload));
+        }
+
+        // false if id is not queued, as when a pop_until on another thread got to it first: the lookup happens
+        // under the shard's lock, so a cancel racing a drain is decided there rather than left to an assert
+        bool remove(const ID& id) {
+            Shard& shard = shard_of(id);
+            std::lock_guard lock{shard.mutex};
+            auto* entry = shard.queue.find(id);
+            if (!entry) { return false; }
+            shard.queue.remove(entry);
+            return true;
+        }
+
+        // false if id is not queued; see remove
+        bool reschedule(const ID& id, Priority new_time) {
+            Shard& shard = shard_of(id);
+            std::lock_guard lock{shard.mutex};
+            auto* entry = shard.queue.find(id);
+            if (!entry) { return false; }
+            shard.queue.reschedule(entry, std::move(new_time));
+            return true;
+        }
+
+        [[nodiscard]] bool contains(const ID& id) const {
+            Shard& shard = shard_of(id);
+            std::lock_guard lock{shard.mutex};
+            return shard.queue.contains(id);
+        }
+
+        // a snapshot that may be stale as soon as it returns
+        [[nodiscard]] size_type size() const {
+            size_type total = 0;
+            for (const auto& shard: _shards) {
+                std::lock_guard lock{shard->mutex};
+                total += shard->queue.size();
+            }
+            return total;
+        }
+
+        [[nodiscard]] size_type num_shards() const noexcept { return _shards.size(); }
+
+        // drains every shard of the entries due by time, one lock at a time, and hands them to sink
+        // (see EagerQueue::pop_until) merged in priority order; sink runs without any lock held
+        // returns the number of entries popped
+        template<typename Sink>
+        size_type pop_until(const Priority& time, Sink sink) {
+            std::vector<std::vector<std::pair<Priority, T>>> runs(_shards.size());
+            for (size_type i = 0; i < _shards.size(); ++i) {
+                std::lock_guard lock{_shards[i]->mutex};
+                _shards[i]->queue.pop_until(time, std::back_inserter(runs[i]));
+            }
+            // k-way merge of the sorted runs, through a heap of (run, position) cursors
+            std::vector<std::pair<size_type, size_type>> cursors;
+            size_type total = 0;
+            for (size_type i = 0; i < runs.size(); ++i) {
+                if (!runs[i].empty()) { cursors.emplace_back(i, 0); }
+                total += runs[i].size();
+            }
+            auto later = [&](const auto& c1, const auto& c2) {
+                return _cmp(runs[c2.first][c2.second].first, runs[c1.first][c1.second].first);
+            };
+            std::make_heap(cursors.begin(), cursors.end(), later);
+            while (!cursors.empty()) {
+                std::pop_heap(cursors.begin(), cursors.end(), later);
+                auto& [run, pos] = cursors.back();
+                auto& [t, payload] = runs[run][pos];
+                detail::emit(sink, std::move(t), std::move(payload));
+                if (++pos < runs[run].size()) {
+                    std::push_heap(cursors.begin(), cursors.end(), later);
+                } else {
+                    cursors.pop_back();
+                }
+            }
+            return total;
+        }
+    };
+}
+
+#endif //GSK_SHARDEDQUEUE_H
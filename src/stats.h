@@ -0,0 +1,78 @@
+#ifndef GSK_STATS_H
+#define GSK_STATS_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <unordered_map>
+
+// opt-in instrumentation of EagerQueue, LazyQueue, RandomSet and RandomDict
+// defining DATA_STRUCTURES_ENABLE_STATS gives each of them a stats() snapshot and a reset_stats();
+// without it the counters are not even members, so they cost nothing
+// the macro changes the layout of those classes: define it the same way in every translation unit
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+#define GSK_STAT(statement) statement
+#else
+#define GSK_STAT(statement) ((void)0)
+#endif
+
+namespace data_structures {
+    // the cost of finding each key in a hash index: a key's probe length is the number of keys
+    // compared before (and including) it, so 1 is the best case
+    struct ProbeStats {
+        std::size_t keys{};
+        std::size_t slots{};  // buckets or table slots
+        std::size_t max_probe{};
+        double mean_probe{};
+    };
+
+    struct QueueStats {
+        // counted since construction or the last reset_stats()
+        std::uint64_t pushes{};
+        std::uint64_t pops{};  // by pop, pop_n and pop_until alike
+        std::uint64_t removes{};
+        std::uint64_t reschedules{};
+        std::uint64_t sift_moves{};  // entries moved by perc_up/perc_down (EagerQueue only)
+        std::uint64_t tombstones_skipped{};  // dead entries dropped off the top (LazyQueue only)
+        std::uint64_t compactions{};  // (LazyQueue only)
+        std::uint64_t rejections{};  // pushes turned away by a full bounded queue (EagerQueue only)
+        std::uint64_t evictions{};  // tops dropped to make room in a bounded queue (EagerQueue only)
+        // the shape at the time of the snapshot
+        std::size_t size{};  // live entries
+        std::size_t heap_size{};  // entries in the heap, tombstones included
+        std::size_t heap_capacity{};
+        ProbeStats index;
+    };
+
+    struct RandomStats {
+        // counted since construction or the last reset_stats()
+        std::uint64_t inserts{};  // of new keys
+        std::uint64_t erases{};  // of present keys, pop_random included
+        std::uint64_t draws{};  // keys handed out at random
+        std::uint64_t hole_fills{};  // last entries moved into the slot of an erased one
+        // the shape at the time of the snapshot
+        std::size_t size{};
+        std::size_t capacity{};  // of the dense storage
+        ProbeStats index;
+    };
+}
+
+namespace data_structures::detail {
+    // walks every bucket; the i-th key of a bucket takes i comparisons to find
+    template<typename K, typename V, typename Hash, typename KeyEqual, typename Alloc>
+    ProbeStats probe_stats(const std::unordered_map<K, V, Hash, KeyEqual, Alloc>& m) {
+        ProbeStats stats;
+        stats.keys = m.size();
+        stats.slots = m.bucket_count();
+        std::size_t total = 0;
+        for (std::size_t b = 0; b < m.bucket_count(); ++b) {
+            const std::size_t n = m.bucket_size(b);
+            total += n * (n + 1) / 2;
+            stats.max_probe = std::max(stats.max_probe, n);
+        }
+        stats.mean_probe = stats.keys ? static_cast<double>(total) / static_cast<double>(stats.keys) : 0.0;
+        return stats;
+    }
+}
+
+#endif //GSK_STATS_H
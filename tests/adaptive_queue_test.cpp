@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include "adaptivequeue.h"
+
+#include <map>
+#include <set>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+
+using namespace data_structures;
+
+TEST(aq_test, test_switch) {
+    AdaptiveQueue<int> q;
+    EXPECT_EQ(q.mode(), QueueMode::lazy);
+    for (int i = 0; i < 100; ++i) {
+        q.push(100 - i, i);
+    }
+    q.remove(50);
+    q.reschedule(0, -1);
+    EXPECT_FALSE(q.contains(50));
+
+    q.switch_to(QueueMode::eager);
+    EXPECT_EQ(q.mode(), QueueMode::eager);
+    EXPECT_EQ(q.switches(), 1);
+    EXPECT_EQ(q.size(), 99);
+    EXPECT_FALSE(q.contains(50));
+    EXPECT_EQ(q.peek().first, -1);
+    EXPECT_EQ(q.peek().second, 0);
+    q.reschedule(99, -2);
+
+    q.switch_to(QueueMode::lazy);
+    q.switch_to(QueueMode::lazy);
+    EXPECT_EQ(q.switches(), 2);
+    std::vector<std::pair<double, int>> due;
+    EXPECT_EQ(q.pop_until(10, std::back_inserter(due)), 11);
+    ASSERT_EQ(due.size(), 11);
+    EXPECT_EQ(due[0], std::make_pair(-2.0, 99));
+    EXPECT_EQ(due[1], std::make_pair(-1.0, 0));
+    EXPECT_EQ(due[10], std::make_pair(10.0, 90));
+    EXPECT_EQ(q.pop(), std::make_pair(11.0, 89));
+    q.clear();
+    EXPECT_EQ(q.size(), 0);
+
+    AdaptiveQueue<std::pair<int, std::string>, int> named{[](const std::pair<int, std::string>& p) { return p.first; }};
+    named.push(2.0, 1, "b");
+    named.push(1.0, 2, "a");
+    named.switch_to(QueueMode::eager);
+    std::string order;
+    named.pop_n(2, [&](double, std::pair<int, std::string>&& p) { order += p.second; });
+    EXPECT_EQ(order, "ab");
+}
+
+TEST(aq_test, test_adapt) {
+    AdaptivePolicy policy;
+    policy.min_window = 64;
+    AdaptiveQueue<int> q{policy};
+    std::map<int, double> times;  // the reference: each queued ID's time, and all of them in order
+    std::set<std::pair<double, int>> order;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> delay(0, 1000);
+    std::uniform_int_distribution<int> ids(0, 999);
+    std::uniform_int_distribution<unsigned> percent(0, 99);
+    for (int i = 0; i < 1000; ++i) {
+        times[i] = delay(rng);
+        order.emplace(times[i], i);
+        q.push(times[i], i);
+    }
+    // each phase runs the given share of reschedules, the rest popping the earliest and pushing it back
+    auto phase = [&](unsigned reschedule_pct) {
+        for (int step = 0; step < 20000; ++step) {
+            if (percent(rng) < reschedule_pct) {
+                const int id = ids(rng);
+                order.erase({times[id], id});
+                times[id] += delay(rng) - 500;
+                order.emplace(times[id], id);
+                q.reschedule(id, times[id]);
+            } else {
+                auto top = q.pop();
+                ASSERT_EQ(top, *order.begin());
+                order.erase(order.begin());
+                times[top.second] = top.first + delay(rng);
+                order.emplace(times[top.second], top.second);
+                q.push(times[top.second], top.second);
+            }
+        }
+    };
+    phase(5);
+    EXPECT_EQ(q.mode(), QueueMode::lazy);
+    EXPECT_EQ(q.switches(), 0);
+    phase(90);
+    EXPECT_EQ(q.mode(), QueueMode::eager);
+    phase(40);  // between the thresholds: stays put
+    EXPECT_EQ(q.mode(), QueueMode::eager);
+    EXPECT_EQ(q.switches(), 1);
+    phase(0);
+    EXPECT_EQ(q.mode(), QueueMode::lazy);
+    EXPECT_EQ(q.switches(), 2);
+
+    ASSERT_EQ(q.size(), times.size());
+    std::vector<std::pair<double, int>> rest;
+    q.pop_n(q.size(), std::back_inserter(rest));
+    EXPECT_TRUE(std::equal(rest.begin(), rest.end(), order.begin(), order.end()));
+}
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include "cache.h"
+
+#include <string>
+#include <vector>
+#include <utility>
+
+using namespace data_structures;
+
+TEST(cache_test, test_random_eviction) {
+    RandomEvictionCache<int, std::string> cache{3, 42};
+    EXPECT_EQ(cache.capacity(), 3);
+    EXPECT_FALSE(cache.put(1, "one"));
+    EXPECT_FALSE(cache.put(2, "two"));
+    EXPECT_FALSE(cache.put(3, "three"));
+    EXPECT_FALSE(cache.put(2, "deux"));  // an overwrite evicts nothing
+    EXPECT_EQ(cache.at(2), "deux");
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_THROW(cache.at(4), std::out_of_range);
+
+    auto evicted = cache.put(4, "four");
+    ASSERT_TRUE(evicted);
+    EXPECT_NE(evicted->first, 4);
+    EXPECT_FALSE(cache.contains(evicted->first));
+    EXPECT_TRUE(cache.contains(4));
+    EXPECT_EQ(cache.size(), 3);
+
+    EXPECT_FALSE(cache.put(4, "quatre"));  // an overwrite through the one lookup
+    EXPECT_EQ(cache.at(4), "quatre");
+    RandomDict<int, std::string> dict{1};
+    EXPECT_TRUE(dict.try_emplace(1, "one").second);
+    auto [it, inserted] = dict.try_emplace(1, "uno");
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(it->second, "one");
+    dict.try_emplace(2, "two");
+    for (int i = 0; i < 20; ++i) {  // never the one kept
+        auto victim = dict.pop_random_except(dict.try_emplace(3, "three").first);
+        EXPECT_NE(victim.first, 3);
+        dict.try_emplace(victim.first, victim.second);
+        dict.erase(3);
+    }
+
+    EXPECT_EQ(cache.erase(4), 1);
+    EXPECT_EQ(cache.erase(4), 0);
+    cache.set_capacity(1);
+    EXPECT_EQ(cache.size(), 1);
+    for (int i = 10; i < 100; ++i) {
+        cache.put(i, std::to_string(i));
+        EXPECT_EQ(cache.size(), 1);
+        EXPECT_EQ(cache.at(i), std::to_string(i));
+    }
+
+    // every old key is as likely to go
+    RandomEvictionCache<int, int> counts{4, 7};
+    std::vector<int> evictions(4);
+    for (int round = 0; round < 4000; ++round) {
+        for (int k = 0; k < 4; ++k) { counts.put(k, k); }
+        auto victim = counts.put(-1, -1);
+        ASSERT_TRUE(victim);
+        ++evictions[victim->first];
+        counts.erase(-1);
+    }
+    for (int n: evictions) { EXPECT_NEAR(n, 1000, 150); }
+}
+
+TEST(cache_test, test_ttl) {
+    TtlCache<std::string, int> cache;
+    cache.put("a", 1, 10);
+    cache.put("b", 2, 20);
+    cache.put("c", 3, 30);
+    EXPECT_EQ(cache.size(), 3);
+    EXPECT_EQ(cache.next_expiry(), 10);
+    ASSERT_NE(cache.find("a", 5), nullptr);
+    EXPECT_EQ(*cache.find("a", 5), 1);
+    EXPECT_EQ(cache.find("a", 10), nullptr);  // expired at its expiry
+    EXPECT_EQ(cache.find("z", 0), nullptr);
+    EXPECT_TRUE(cache.contains("c", 29.5));
+
+    cache.put("a", 11, 40);  // a new value and expiry
+    EXPECT_EQ(*cache.find("a", 35), 11);
+    EXPECT_EQ(cache.next_expiry(), 20);
+    EXPECT_TRUE(cache.refresh("b", 50));
+    *cache.find("b", 0) = 22;
+
+    std::vector<std::pair<std::string, int>> expired;
+    EXPECT_EQ(cache.expire(45, [&](std::string&& key, int&& val) { expired.emplace_back(key, val); }), 2);
+    ASSERT_EQ(expired.size(), 2);
+    EXPECT_EQ(expired[0], std::make_pair(std::string("c"), 3));
+    EXPECT_EQ(expired[1], std::make_pair(std::string("a"), 11));
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(*cache.find("b", 45), 22);
+
+    EXPECT_EQ(cache.erase("b"), 1);
+    EXPECT_EQ(cache.erase("b"), 0);
+    EXPECT_FALSE(cache.refresh("b", 60));  // not cached, so nothing to move
+    EXPECT_THROW(cache.next_expiry(), std::runtime_error);
+
+    // a large batch goes through the partitioning path of pop_until
+    TtlCache<int, int, std::hash<int>, std::equal_to<int>, std::uint64_t> ticks;
+    for (int i = 0; i < 10000; ++i) { ticks.put(i, i, static_cast<std::uint64_t>(10000 - i)); }
+    EXPECT_EQ(ticks.expire(5000), 5000);
+    EXPECT_EQ(ticks.size(), 5000);
+    for (int i = 0; i < 10000; ++i) {
+        EXPECT_EQ(ticks.find(i, 0) != nullptr, i < 5000);
+    }
+    ticks.clear();
+    EXPECT_EQ(ticks.size(), 0);
+}
@@ -0,0 +1,76 @@
+#include "gtest/gtest.h"
+#include <thread>
+#include <array>
+#include "concurrentrandomdict.h"
+using namespace data_structures;
+
+TEST(crs_test, test_simple) {
+    ConcurrentRandomSet<int> crs;
+    EXPECT_ANY_THROW(crs.random_elem());
+    for (int i = 0; i < 1000; ++i) { EXPECT_EQ(crs.insert(i), 1); }
+    EXPECT_EQ(crs.insert(5), 0);
+    EXPECT_EQ(crs.size(), 1000);
+    for (int i = 0; i < 1000; i += 2) { EXPECT_EQ(crs.erase(i), 1); }
+    EXPECT_EQ(crs.erase(0), 0);
+    EXPECT_EQ(crs.size(), 500);
+    for (int i = 0; i < 1000; ++i) {
+        const int key = crs.random_elem();
+        EXPECT_EQ(key % 2, 1);
+        EXPECT_EQ(crs.count(key), 1);
+    }
+    std::vector<int> keys;
+    crs.sample(10, std::back_inserter(keys));
+    EXPECT_EQ(keys.size(), 10);
+    crs.clear();
+    EXPECT_EQ(crs.size(), 0);
+    EXPECT_ANY_THROW(crs.sample(1, std::back_inserter(keys)));
+    EXPECT_EQ(crs.insert(3), 1);
+    EXPECT_EQ(crs.random_elem(), 3);
+}
+
+TEST(crd_test, test_simple) {
+    ConcurrentRandomDict<int, double> crd;
+    EXPECT_EQ(crd.insert(1, 1.5), 1);
+    EXPECT_EQ(crd.insert(1, 2.5), 0);
+    EXPECT_EQ(crd.at(1), 1.5);
+    EXPECT_EQ(crd.insert_or_assign(1, 2.5), 0);
+    EXPECT_EQ(crd.insert_or_assign(2, 3.5), 1);
+    EXPECT_EQ(crd.at(1), 2.5);
+    EXPECT_ANY_THROW(crd.at(3));
+    EXPECT_EQ(crd.erase(1), 1);
+    EXPECT_EQ(crd.random_pair(), std::make_pair(2, 3.5));
+}
+
+TEST(crd_test, test_concurrent) {
+    using Value = std::array<std::uint64_t, 3>;  // several words, so that torn reads would show
+    ConcurrentRandomDict<int, Value> crd;
+    const int n = 5000;
+    for (int i = 0; i < n; ++i) {
+        const auto w = static_cast<std::uint64_t>(i);
+        crd.insert(i, Value{w, w, w});
+    }
+    std::atomic<bool> done{false};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&]() {
+            std::size_t checked = 0;
+            while (!done.load() || checked < 1000) {
+                const auto [key, val] = crd.random_pair();
+                ASSERT_GE(key, 0);
+                const auto w = static_cast<std::uint64_t>(key);
+                ASSERT_EQ(val[0], w);
+                ASSERT_EQ(val[1], w);
+                ASSERT_EQ(val[2], w);
+                ++checked;
+            }
+        });
+    }
+    for (int round = 0; round < 20000; ++round) {  // churn while readers sample
+        const int key = round % (2 * n);
+        const auto w = static_cast<std::uint64_t>(key);
+        if (crd.erase(key) == 0) { crd.insert(key, Value{w, w, w}); }
+    }
+    done = true;
+    for (auto& reader: readers) { reader.join(); }
+    EXPECT_GT(crd.size(), 0);
+}
@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+#include "flatmap.h"
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <string_view>
+
+using namespace data_structures;
+
+TEST(fm_test, test_simple) {
+    FlatMap<std::string, int> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.find("a"), m.end());
+    EXPECT_TRUE(m.emplace("a", 1).second);
+    EXPECT_FALSE(m.emplace("a", 2).second);  // no-op for dup
+    EXPECT_TRUE(m.try_emplace("b", 2).second);
+    m["c"] = 3;
+    EXPECT_EQ(m.size(), 3);
+    EXPECT_EQ(m.at("a"), 1);
+    EXPECT_ANY_THROW(m.at("d"));
+    EXPECT_EQ(m.count("c"), 1);
+    EXPECT_EQ(m.erase("c"), 1);
+    EXPECT_EQ(m.erase("c"), 0);
+    EXPECT_FALSE(m.contains("c"));
+    int sum = 0;
+    for (const auto& [key, val]: m) {
+        sum += val;
+    }
+    EXPECT_EQ(sum, 3);
+
+    auto copy = m;
+    m.clear();
+    EXPECT_EQ(m.size(), 0);
+    EXPECT_EQ(copy.size(), 2);
+    EXPECT_EQ(copy.at("b"), 2);
+    m = std::move(copy);
+    EXPECT_EQ(m.at("a"), 1);
+    m.reserve(1000);
+    EXPECT_GE(m.capacity() * m.max_load_factor(), 1000);
+    EXPECT_EQ(m.at("b"), 2);
+}
+
+TEST(fm_test, test_random_ops) {  // checked against std::unordered_map
+    FlatMap<int, int> m;
+    std::unordered_map<int, int> reference;
+    std::mt19937 rng(123);
+    std::uniform_int_distribution<int> keys(0, 2000);
+    for (int i = 0; i < 50000; ++i) {
+        int key = keys(rng);
+        switch (rng() % 3) {
+            case 0:
+                EXPECT_EQ(m.emplace(key, i).second, reference.emplace(key, i).second);
+                break;
+            case 1:
+                EXPECT_EQ(m.erase(key), reference.erase(key));
+                break;
+            default: {
+                auto it = m.find(key);
+                auto ref_it = reference.find(key);
+                ASSERT_EQ(it == m.end(), ref_it == reference.end());
+                if (it != m.end()) {
+                    EXPECT_EQ(it->second, ref_it->second);
+                    m.erase(it);
+                    reference.erase(ref_it);
+                }
+            }
+        }
+        ASSERT_EQ(m.size(), reference.size());
+    }
+    std::size_t visited = 0;
+    for (const auto& [key, val]: m) {
+        EXPECT_EQ(reference.at(key), val);
+        ++visited;
+    }
+    EXPECT_EQ(visited, reference.size());
+}
+
+TEST(fm_test, test_bad_hash) {
+    struct Constant {
+        std::size_t operator()(int) const noexcept { return 42; }
+    };
+    FlatMap<int, int, Constant> m;
+    for (int i = 0; i < 200; ++i) {  // one long cluster still works
+        m.emplace(i, i);
+    }
+    for (int i = 0; i < 200; i += 2) {
+        m.erase(i);
+    }
+    for (int i = 1; i < 200; i += 2) {
+        EXPECT_EQ(m.at(i), i);
+    }
+    EXPECT_EQ(m.count(0), 0);
+}
+
+namespace {
+    // not convertible to std::string, so lookups by it only compile on the heterogeneous path
+    struct Token {
+        std::string_view name;
+    };
+    struct TokenHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        std::size_t operator()(const Token& t) const { return (*this)(t.name); }
+    };
+    struct TokenEqual {
+        using is_transparent = void;
+        static std::string_view view(std::string_view s) { return s; }
+        static std::string_view view(const Token& t) { return t.name; }
+        template<typename A, typename B>
+        bool operator()(const A& a, const B& b) const { return view(a) == view(b); }
+    };
+}
+
+TEST(fm_test, test_transparent) {
+    FlatMap<std::string, int, TokenHash, TokenEqual> fm;
+    fm["alpha"] = 1;
+    fm["beta"] = 2;
+    EXPECT_EQ(fm.count(Token{"alpha"}), 1);
+    EXPECT_TRUE(fm.contains(std::string_view("beta")));
+    EXPECT_FALSE(fm.contains(Token{"gamma"}));
+    EXPECT_EQ(fm.at(Token{"beta"}), 2);
+    EXPECT_ANY_THROW(fm.at(Token{"gamma"}));
+    EXPECT_EQ(fm.find(Token{"alpha"})->second, 1);
+    EXPECT_EQ(fm.try_emplace(std::string_view("alpha"), 5).second, false);
+    EXPECT_EQ(fm.erase(Token{"alpha"}), 1);
+    EXPECT_EQ(fm.erase(Token{"alpha"}), 0);
+    fm.erase(fm.begin());  // still picks the iterator overload
+    EXPECT_EQ(fm.size(), 0);
+}
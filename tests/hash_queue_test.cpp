@@ -5,6 +5,12 @@
 #include <random>
 #include <unordered_set>
 #include <memory>
+#include <string_view>
+#include <array>
+#include <algorithm>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 
 using namespace data_structures;
 
@@ -87,6 +93,115 @@ void test_sorting() {
     }
 }
 
+TEST(hq_test, test_bulk_build) {
+    std::vector wrong {std::make_pair(3.5, 1), std::make_pair(6.9, 1)};
+    ASSERT_DEATH(EagerQueue<int> hWrong{wrong}, "");
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> distrib(0, 100);
+    std::vector<std::pair<double, int>> v;
+    for (int i = 0; i < 300; ++i) {
+        v.emplace_back(distrib(rng), i);
+    }
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4> q{v};
+    EXPECT_EQ(q.size(), v.size());
+    std::vector<std::pair<double, int>> small, large;
+    for (int i = 300; i < 310; ++i) {
+        small.emplace_back(distrib(rng), i);
+    }
+    for (int i = 310; i < 1000; ++i) {
+        large.emplace_back(distrib(rng), i);
+    }
+    q.push_range(small.begin(), small.end());  // sifted up one by one
+    q.push_range(std::make_move_iterator(large.begin()), std::make_move_iterator(large.end()));  // re-heapified
+    v.insert(v.end(), small.begin(), small.end());
+    v.insert(v.end(), large.begin(), large.end());
+    // locs must be right for remove/reschedule to work
+    for (int i = 0; i < 1000; i += 3) {
+        q.remove(i);
+    }
+    for (int i = 1; i < 1000; i += 3) {
+        v[i].first = -v[i].first;
+        q.reschedule(i, v[i].first);
+    }
+    std::vector<std::pair<double, int>> expected;
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 3) { expected.push_back(v[i]); }
+    }
+    std::sort(expected.begin(), expected.end());
+    for (const auto& e: expected) {
+        EXPECT_EQ(e, q.pop());
+    }
+    EXPECT_EQ(q.size(), 0);
+}
+
+TEST(hq_test, test_bounded) {
+    // the 10 highest scores of a stream, against a full sort
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4, double, std::less<double>, DynamicIdOf<int, int>,
+            FlatIndex> top{Capacity{10}};
+    EXPECT_EQ(top.capacity(), 10);
+    std::mt19937 rng(29);
+    std::uniform_int_distribution<int> scores(0, 1000);
+    std::vector<std::pair<double, int>> all;
+    std::size_t rejected = 0;
+    for (int i = 0; i < 5000; ++i) {
+        const double score = scores(rng);
+        all.emplace_back(score, i);
+        rejected += !top.push(score, i);
+        ASSERT_LE(top.size(), 10);
+    }
+    EXPECT_GT(rejected, 4000);
+    std::sort(all.begin(), all.end());
+    const double cutoff = all[all.size() - 10].first;
+    EXPECT_EQ(top.peek().first, cutoff);
+    EXPECT_FALSE(top.push(cutoff, -1));  // no better than the worst kept: turned away
+    EXPECT_FALSE(top.contains(-1));
+    EXPECT_EQ(top.stats().rejections, rejected + 1);
+    EXPECT_EQ(top.stats().evictions, 5000 - rejected - 10);
+
+    // IDs still work, and make room
+    const int worst = top.peek().second;
+    top.remove(worst);
+    EXPECT_TRUE(top.push(-1, -1));  // below everything, but there is room
+    EXPECT_EQ(top.pop(), std::make_pair(-1.0, -1));
+    ASSERT_TRUE(top.push(2000, -2));
+    top.reschedule(-2, 3000);
+    std::vector<std::pair<double, int>> kept;
+    top.pop_n(10, std::back_inserter(kept));
+    ASSERT_EQ(kept.size(), 10);
+    EXPECT_EQ(kept.back(), std::make_pair(3000.0, -2));
+    for (std::size_t i = 0; i + 1 < kept.size(); ++i) {  // the best nine of the stream, minus the one removed
+        EXPECT_EQ(kept[i].first, all[all.size() - 9 + i].first);
+    }
+
+    // the 3 lowest latencies, bulk-loaded and merged
+    EagerQueue<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 2, int,
+            std::greater<int>> fastest{Capacity{3}};
+    std::vector<std::pair<int, std::string>> latencies{{30, "c"}, {10, "a"}, {50, "e"}, {20, "b"}, {40, "d"}};
+    fastest.push_range(latencies.begin(), latencies.end());
+    EXPECT_EQ(fastest.size(), 3);
+    EXPECT_EQ(fastest.peek().first, 30);
+    EXPECT_EQ(fastest.peek().second, "c");
+    EagerQueue<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, 2, int,
+            std::greater<int>> more;
+    more.push(5, "z");
+    more.push(25, "y");
+    fastest.merge(more);
+    EXPECT_EQ(fastest.size(), 3);
+    EXPECT_EQ(fastest.pop().second, "b");
+    EXPECT_EQ(fastest.pop().second, "a");
+    EXPECT_EQ(fastest.pop().second, "z");
+
+    // a bounded queue reuses its storage: no allocation once full, with a flat index
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 2, double, std::less<double>, DynamicIdOf<int, int>,
+            FlatIndex> window{Capacity{64}};
+    for (int i = 0; i < 64; ++i) { window.push(i, i); }
+    const auto heap_capacity = window.stats().heap_capacity;
+    for (int i = 64; i < 10000; ++i) { window.push(i, i); }
+    EXPECT_EQ(window.stats().heap_capacity, heap_capacity);
+    EXPECT_EQ(window.peek().first, 10000 - 64);
+}
+
 TEST(hq_test, test_fix) {
     EagerQueue<int> q;
     q.push(0, 0);
@@ -95,16 +210,127 @@ TEST(hq_test, test_fix) {
     ASSERT_EQ(q.peek().first, 0);
     ASSERT_TRUE(q.contains(1));
     q.reschedule(1, 666);
+    EXPECT_EQ(q.at(1).first, 666);
+    EXPECT_EQ(std::as_const(q).at(2).second, 2);
+    EXPECT_THROW(q.at(3), std::out_of_range);
     q.pop();
     ASSERT_EQ(q.peek().first, 2);
     q.pop();
     ASSERT_EQ(q.peek().first, 666);
     ASSERT_EQ(q.size(), 1);
+
+    // one lookup, then the entry itself
+    q.push(3, 3);
+    auto* entry = q.find(1);
+    ASSERT_NE(entry, nullptr);
+    EXPECT_EQ(entry->payload, 1);
+    EXPECT_EQ(q.find(2), nullptr);
+    q.reschedule(entry, -1);
+    EXPECT_EQ(q.peek().first, -1);
+    EXPECT_EQ(std::as_const(q).find(3)->time, 3);
+    q.remove(entry);  // the top, moving 3 up
+    EXPECT_FALSE(q.contains(1));
+    EXPECT_EQ(q.peek().first, 3);
+    q.push(4, 4);
+    q.remove(q.find(4));  // the last slot
+    EXPECT_EQ(q.size(), 1);
+    EXPECT_EQ(q.pop().second, 3);
 }
 
 TEST(hq_test, test_sort) {
     test_sorting<LazyQueue<int>>();
     test_sorting<EagerQueue<int>>();
+    test_sorting<EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 3>>();
+    test_sorting<EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 8>>();
+    // the same against the flat index
+    using Convert = ConvertId<int, int>;
+    test_sorting<LazyQueue<int, int, std::hash<int>, std::equal_to<int>, double, std::less<double>, Convert, FlatIndex>>();
+    test_sorting<EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4, double, std::less<double>, Convert, FlatIndex>>();
+}
+
+template<std::size_t Arity>
+void test_reschedule_arity() {
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, Arity> q;
+    std::mt19937 rng(Arity);
+    std::uniform_real_distribution<double> distrib(0, 100);
+    std::vector<double> times;
+    for (int i = 0; i < 500; ++i) {
+        times.push_back(distrib(rng));
+        q.push(times.back(), i);
+    }
+    for (int round = 0; round < 2000; ++round) {
+        int id = static_cast<int>(rng() % times.size());
+        times[id] = distrib(rng);
+        q.reschedule(id, times[id]);
+    }
+    double last = -1;
+    while (q.size()) {
+        auto [time, id] = q.pop();
+        EXPECT_EQ(time, times[id]);
+        EXPECT_LE(last, time);
+        last = time;
+    }
+}
+
+TEST(hq_test, test_arity) {
+    test_reschedule_arity<2>();
+    test_reschedule_arity<4>();
+    test_reschedule_arity<5>();
+}
+
+template<std::size_t Arity>
+void test_simd_arity() {
+    // whole-number times so that siblings tie often; ties must resolve like the scalar scan
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, Arity> q;
+    std::mt19937 rng(Arity);
+    std::uniform_int_distribution<int> distrib(0, 50);
+    std::vector<std::pair<double, int>> bulk;
+    for (int i = 0; i < 300; ++i) { bulk.emplace_back(distrib(rng), i); }
+    q.push_range(bulk.begin(), bulk.end());
+    std::vector<double> times(600, -1);
+    for (auto [time, id]: bulk) { times[id] = time; }
+    for (int i = 300; i < 600; ++i) {
+        times[i] = distrib(rng);
+        q.push(times[i], i);
+    }
+    for (int round = 0; round < 2000; ++round) {
+        const int id = static_cast<int>(rng() % times.size());
+        if (times[id] < 0) { continue; }
+        if (round % 3) {
+            times[id] = distrib(rng);
+            q.reschedule(id, times[id]);
+        } else {
+            q.remove(id);
+            times[id] = -1;
+        }
+    }
+    double last = -1;
+    q.pop_until(10, [&](double time, int&& id) {
+        EXPECT_EQ(time, times[id]);
+        EXPECT_LE(last, time);
+        last = time;
+        times[id] = -1;
+    });
+    while (q.size()) {
+        auto [time, id] = q.pop();
+        EXPECT_EQ(time, times[id]);
+        EXPECT_LE(last, time);
+        last = time;
+        times[id] = -1;
+    }
+    EXPECT_EQ(std::count(times.begin(), times.end(), -1), static_cast<std::ptrdiff_t>(times.size()));
+}
+
+TEST(hq_test, test_simd_heap) {
+    if constexpr (detail::has_simd_min_child<4, double, std::less<double>>) {
+        const double keys[8] = {3, 1, 4, 1, 5, 2, 9, 2};
+        EXPECT_EQ((detail::simd_min_child<4>(keys)), 1);
+        EXPECT_EQ((detail::simd_min_child<8>(keys)), 1);
+        EXPECT_EQ((detail::simd_min_child<4>(keys + 4)), 1);
+    }
+    test_simd_arity<4>();
+    test_simd_arity<8>();
+    test_simd_arity<3>();  // no vector path: the inline keys alone
 }
 
 struct A {
@@ -165,4 +391,593 @@ TEST(hq_test, test_obj_simple) {
     }
     ASSERT_EQ(ss.str(), "A(0, 0) @ 1\n"
                         "A(1, 1) @ 4\n");
-}
\ No newline at end of file
+}
+TEST(hq_test, test_pool) {
+    EagerQueue<int>::pool_type pool;
+    {
+        EagerQueue<int> q1{pool};
+        EagerQueue<int> q2{pool};  // two queues drawing from the same pool
+        for (int i = 0; i < 100; ++i) {
+            q1.push(i, i);
+            q2.push(-i, i);
+        }
+        const auto capacity = pool.capacity();
+        EXPECT_GE(capacity, 200);
+        for (int round = 0; round < 10; ++round) {  // churn should recycle slots instead of growing the pool
+            for (int i = 0; i < 50; ++i) {
+                q1.remove(i);
+                q2.pop();
+            }
+            for (int i = 0; i < 50; ++i) {
+                q1.push(i, i);
+                q2.push(round, 1000 + 100 * round + i);
+            }
+        }
+        EXPECT_EQ(pool.capacity(), capacity);
+        EXPECT_EQ(q1.size(), 100);
+        EXPECT_EQ(q1.pop().second, 0);
+        q2.pop();
+    }
+    LazyQueue<std::string>::pool_type lazy_pool;
+    lazy_pool.reserve(8);
+    LazyQueue<std::string> q{lazy_pool};
+    q.push(2, "b");
+    q.push(1, "a");
+    q.remove("b");
+    EXPECT_EQ(q.pop(), std::make_pair(1.0, std::string("a")));
+    EXPECT_EQ(lazy_pool.capacity(), 8);
+}
+
+TEST(hq_test, test_lazy_compact) {
+    LazyQueue<int>::pool_type pool;
+    LazyQueue<int> q{pool};
+    for (int i = 0; i < 1000; ++i) {
+        q.push(i, i);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 5) { q.remove(i); }  // cancel 80%
+    }
+    EXPECT_EQ(q.size(), 200);
+    // tombstones are bounded by the ratio, so entries get recycled instead of piling up
+    for (int i = 0; i < 10000; ++i) {
+        q.push(5000 + i, 5000 + i);
+        q.remove(5000 + i);
+    }
+    EXPECT_LE(pool.capacity(), 1024);
+    for (int i = 0; i < 1000; ++i) {
+        if (i % 5) { q.push(i, i); }
+    }
+
+    for (int i = 0; i < 1000; i += 2) {
+        q.reschedule(i, 2000 - i);
+    }
+    q.max_tombstone_ratio(1);  // no automatic compaction from here on
+    q.reschedule(1, -1);
+    q.remove(3);
+    q.compact();
+    EXPECT_EQ(q.size(), 999);
+    EXPECT_EQ(q.pop(), std::make_pair(-1.0, 1));
+    double last = -1;
+    while (q.size()) {
+        auto [time, id] = q.pop();
+        EXPECT_EQ(time, id % 2 ? id : 2000 - id);
+        EXPECT_LE(last, time);
+        last = time;
+    }
+}
+
+template<typename QT>
+void test_priority_type() {
+    // adjacent ticks past 2^53 collapse into the same double
+    const std::uint64_t base = (std::uint64_t{1} << 60) + 1;
+    QT q;
+    q.push(base + 2, 2);
+    q.push(base, 0);
+    q.push(base + 1, 1);
+    q.push(base + 3, 3);
+    q.remove(3);
+    q.reschedule(0, base + 4);
+    EXPECT_EQ(q.peek().first, base + 1);
+    EXPECT_EQ(q.pop(), std::make_pair(base + 1, 1));
+    EXPECT_EQ(q.pop(), std::make_pair(base + 2, 2));
+    EXPECT_EQ(q.pop(), std::make_pair(base + 4, 0));
+}
+
+TEST(hq_test, test_priority_type) {
+    test_priority_type<EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 2, std::uint64_t>>();
+    test_priority_type<LazyQueue<int, int, std::hash<int>, std::equal_to<int>, std::uint64_t>>();
+    // a max-heap via the comparator
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4, int, std::greater<>> max_q;
+    LazyQueue<int, int, std::hash<int>, std::equal_to<int>, int, std::greater<>> lazy_max_q;
+    for (int i = 0; i < 100; ++i) {
+        max_q.push((i * 37) % 100, i);
+        lazy_max_q.push((i * 37) % 100, i);
+    }
+    for (int p = 99; p >= 0; --p) {
+        EXPECT_EQ(max_q.pop().first, p);
+        EXPECT_EQ(lazy_max_q.pop().first, p);
+    }
+}
+
+TEST(hq_test, test_monotone) {
+    MonotoneQueue<int> empty;
+    EXPECT_ANY_THROW(empty.pop());
+    EXPECT_ANY_THROW(empty.peek());
+
+    // simulate a clock that only moves forward, checking against an EagerQueue
+    MonotoneQueue<int, int, std::hash<int>, std::equal_to<int>, std::uint32_t, DynamicIdOf<int, int>, FlatIndex> q;
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 2, std::uint32_t> reference;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<std::uint32_t> delay(0, 1000);
+    std::uint32_t now = 0;
+    int next_id = 0;
+    for (int i = 0; i < 200; ++i, ++next_id) {
+        auto t = delay(rng);
+        q.push(t, next_id);
+        reference.push(t, next_id);
+    }
+    for (int round = 0; round < 5000; ++round) {
+        auto lucky = static_cast<int>(rng() % next_id);
+        switch (rng() % 4) {
+            case 0:
+                if (q.contains(lucky)) {
+                    q.remove(lucky);
+                    reference.remove(lucky);
+                }
+                break;
+            case 1:
+                if (q.contains(lucky)) {
+                    auto t = now + delay(rng);
+                    q.reschedule(lucky, t);
+                    reference.reschedule(lucky, t);
+                }
+                break;
+            default: {
+                auto t = now + delay(rng);
+                q.push(t, next_id);
+                reference.push(t, next_id);
+                ++next_id;
+                auto expected = reference.pop();
+                auto popped = q.pop();
+                EXPECT_EQ(popped.first, expected.first);
+                if (popped.second != expected.second) {  // a tie; both are due at the same time
+                    reference.push(expected.first, expected.second);
+                    reference.remove(popped.second);
+                }
+                now = popped.first;
+            }
+        }
+        ASSERT_EQ(q.size(), reference.size());
+    }
+    EXPECT_ANY_THROW(q.push(now - 1, next_id));
+    while (q.size()) {
+        EXPECT_EQ(q.peek().first, reference.peek().first);
+        EXPECT_EQ(q.pop().first, reference.pop().first);
+    }
+}
+
+TEST(hq_test, test_pairing) {
+    PairingQueue<int> empty;
+    EXPECT_ANY_THROW(empty.pop());
+    EXPECT_ANY_THROW(empty.peek());
+
+    // decreases, increases, removals and pops on whole-number times, checked against the current times
+    PairingQueue<int, int, std::hash<int>, std::equal_to<int>, double, std::less<double>, DynamicIdOf<int, int>,
+            FlatIndex> q;
+    std::mt19937 rng(27);
+    std::uniform_int_distribution<int> distrib(0, 100);
+    std::vector<double> times(1000, -1);
+    for (int i = 0; i < 300; ++i) {
+        times[i] = distrib(rng);
+        q.push(times[i], i);
+    }
+    std::size_t live = 300;
+    double last = -1;
+    for (int round = 0; round < 20000; ++round) {
+        const int id = static_cast<int>(rng() % times.size());
+        const bool queued = times[id] >= 0;
+        ASSERT_EQ(q.contains(id), queued);
+        switch (rng() % 5) {
+            case 0:
+            case 1:  // decrease-key, the common case of a graph search
+                if (queued) {
+                    times[id] = std::max(last, times[id] - distrib(rng));
+                    q.reschedule(id, times[id]);
+                }
+                break;
+            case 2:
+                if (queued) {
+                    times[id] += distrib(rng);
+                    q.reschedule(id, times[id]);
+                }
+                break;
+            case 3:
+                if (queued) {
+                    q.remove(id);
+                    times[id] = -1;
+                    --live;
+                } else {
+                    times[id] = last + distrib(rng);
+                    q.push(times[id], id);
+                    ++live;
+                }
+                break;
+            default:
+                if (live) {
+                    auto [time, popped] = q.pop();
+                    EXPECT_EQ(time, times[popped]);
+                    EXPECT_LE(last, time);
+                    last = time;
+                    times[popped] = -1;
+                    --live;
+                }
+        }
+        ASSERT_EQ(q.size(), live);
+    }
+    std::vector<std::pair<double, int>> due;
+    q.pop_until(last + 50, std::back_inserter(due));
+    EXPECT_TRUE(std::is_sorted(due.begin(), due.end(),
+                               [](const auto& a, const auto& b) { return a.first < b.first; }));
+    for (auto [time, id]: due) {
+        EXPECT_EQ(time, times[id]);
+        EXPECT_LE(time, last + 50);
+        times[id] = -1;
+    }
+    EXPECT_EQ(q.pop_n(q.size(), [&](double time, int&& id) {
+        EXPECT_EQ(time, times[id]);
+        EXPECT_LT(last + 50, time);
+        times[id] = -1;
+    }), live - due.size());
+    EXPECT_EQ(q.size(), 0);
+    EXPECT_EQ(std::count(times.begin(), times.end(), -1), static_cast<std::ptrdiff_t>(times.size()));
+
+    // a max-queue of strings, destroyed while non-empty
+    PairingQueue<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, int, std::greater<int>> words;
+    words.push(1, "one");
+    words.push(3, "three");
+    words.push(2, "two");
+    words.reschedule("one", 4);
+    EXPECT_EQ(words.peek().second, "one");
+    words.reschedule("one", 0);
+    EXPECT_EQ(words.pop(), std::make_pair(3, std::string("three")));
+    EXPECT_EQ(words.size(), 2);
+}
+
+TEST(hq_test, test_static_id_of) {
+    auto id_of = [](const A& a) { return a.x; };
+    EagerQueue<A, int, std::hash<int>, std::equal_to<int>, 2, double, std::less<double>, decltype(id_of)> q{id_of};
+    LazyQueue<A, int, std::hash<int>, std::equal_to<int>, double, std::less<double>, decltype(id_of)> lq{id_of};
+    for (int i = 0; i < 10; ++i) {
+        q.push(10 - i, i, -i);
+        lq.push(10 - i, i, -i);
+    }
+    q.remove(9);
+    lq.remove(9);
+    q.reschedule(0, -1);
+    EXPECT_TRUE(q.contains(0));
+    EXPECT_FALSE(q.contains(9));
+    EXPECT_EQ(q.pop().second.x, 0);
+    EXPECT_EQ(q.pop().second.y, -8);
+    EXPECT_EQ(lq.pop().second.y, -8);
+
+    using Convert = ConvertId<int, int>;
+    MonotoneQueue<int, int, std::hash<int>, std::equal_to<int>, std::uint64_t, Convert> mq;
+    LazyQueue<int, int, std::hash<int>, std::equal_to<int>, double, std::less<double>, Convert> cq{
+        std::vector{std::make_pair(2.0, 2), std::make_pair(1.0, 1)}};
+    mq.push(3, 3);
+    mq.push(1, 1);
+    EXPECT_EQ(mq.pop(), std::make_pair(std::uint64_t{1}, 1));
+    EXPECT_EQ(cq.pop(), std::make_pair(1.0, 1));
+}
+
+template<typename QT>
+void test_drain(QT& q) {
+    std::vector<std::pair<double, int>> expected;
+    for (int i = 0; i < 1000; ++i) {
+        double time = (i * 7919) % 1000;
+        q.push(time, i);
+        if (i % 4) { expected.emplace_back(time, i); }
+    }
+    for (int i = 0; i < 1000; i += 4) {
+        q.remove(i);
+    }
+    std::sort(expected.begin(), expected.end());
+    std::vector<std::pair<double, int>> drained;
+    EXPECT_EQ(q.pop_until(-1, std::back_inserter(drained)), 0);
+    EXPECT_EQ(q.pop_until(9, std::back_inserter(drained)), 7);  // small batch: sifted one by one
+    EXPECT_EQ(q.pop_n(3, [&](double time, int&& id) { drained.emplace_back(time, id); }), 3);
+    EXPECT_EQ(q.pop_until(600, std::back_inserter(drained)), 440);  // large batch: cut out and re-heapified
+    EXPECT_EQ(q.size(), 300);
+    EXPECT_EQ(q.pop_n(1000, std::back_inserter(drained)), 300);
+    EXPECT_EQ(drained, expected);
+    EXPECT_EQ(q.pop_until(2000, std::back_inserter(drained)), 0);
+}
+
+TEST(hq_test, test_drain) {
+    EagerQueue<int> eager;
+    test_drain(eager);
+    LazyQueue<int> lazy;
+    lazy.max_tombstone_ratio(1);  // keep the tombstones in the heap for pop_until to skip
+    test_drain(lazy);
+    // the remaining entries are still properly indexed after cutting a batch out
+    EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4> q;
+    for (int i = 0; i < 100; ++i) {
+        q.push(i, i);
+    }
+    std::vector<int> ids;
+    q.pop_until(80, [&](double, int id) { ids.push_back(id); });
+    EXPECT_EQ(ids.size(), 81);
+    q.reschedule(99, 0);
+    q.remove(90);
+    EXPECT_EQ(q.pop().second, 99);
+    EXPECT_EQ(q.pop().second, 81);
+}
+
+namespace {
+    struct Token {  // not convertible to std::string
+        std::string_view name;
+    };
+    struct TokenHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        std::size_t operator()(const Token& t) const { return (*this)(t.name); }
+    };
+    struct TokenEqual {
+        using is_transparent = void;
+        static std::string_view view(std::string_view s) { return s; }
+        static std::string_view view(const Token& t) { return t.name; }
+        template<typename A, typename B>
+        bool operator()(const A& a, const B& b) const { return view(a) == view(b); }
+    };
+}
+
+template<typename QT>
+void test_transparent_lookup() {
+    QT q;
+    q.push(3, "c");
+    q.push(1, "a");
+    q.push(2, "b");
+    EXPECT_TRUE(q.contains(Token{"a"}));
+    EXPECT_FALSE(q.contains(Token{"d"}));
+    q.reschedule(Token{"c"}, 0);
+    q.remove(Token{"a"});
+    EXPECT_EQ(q.size(), 2);
+    EXPECT_EQ(q.pop().second, "c");
+    EXPECT_EQ(q.pop().second, "b");
+}
+
+TEST(hq_test, test_transparent) {
+    using Convert = ConvertId<std::string, std::string>;
+    test_transparent_lookup<EagerQueue<std::string, std::string, TokenHash, TokenEqual, 2, double,
+            std::less<double>, Convert, FlatIndex>>();
+    test_transparent_lookup<LazyQueue<std::string, std::string, TokenHash, TokenEqual, double,
+            std::less<double>, Convert, FlatIndex>>();
+    test_transparent_lookup<MonotoneQueue<std::string, std::string, TokenHash, TokenEqual, std::uint64_t,
+            Convert, FlatIndex>>();
+#ifdef __cpp_lib_generic_unordered_lookup
+    test_transparent_lookup<EagerQueue<std::string, std::string, TokenHash, TokenEqual, 2, double,
+            std::less<double>, Convert>>();
+    test_transparent_lookup<LazyQueue<std::string, std::string, TokenHash, TokenEqual, double,
+            std::less<double>, Convert>>();
+#endif
+}
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+TEST(hq_test, test_stats) {
+    EagerQueue<int> eager;
+    for (int i = 0; i < 100; ++i) { eager.push(100 - i, i); }  // every push sifts to the top
+    auto stats = eager.stats();
+    EXPECT_EQ(stats.pushes, 100);
+    EXPECT_GT(stats.sift_moves, 0);
+    EXPECT_EQ(stats.size, 100);
+    EXPECT_EQ(stats.index.keys, 100);
+    EXPECT_GE(stats.index.mean_probe, 1.0);
+    eager.remove(5);
+    eager.reschedule(6, 0);
+    eager.pop();
+    stats = eager.stats();
+    EXPECT_EQ(stats.removes, 1);
+    EXPECT_EQ(stats.reschedules, 1);
+    EXPECT_EQ(stats.pops, 1);
+    EXPECT_EQ(stats.tombstones_skipped, 0);
+    eager.reset_stats();
+    EXPECT_EQ(eager.stats().pushes, 0);
+    EXPECT_EQ(eager.stats().size, 98);
+
+    LazyQueue<int, int, std::hash<int>, std::equal_to<int>, double, std::less<double>, DynamicIdOf<int, int>,
+            FlatIndex> lazy;
+    lazy.max_tombstone_ratio(1.0);  // keep every tombstone
+    for (int i = 0; i < 10; ++i) { lazy.push(i, i); }
+    lazy.remove(0);
+    lazy.reschedule(1, 100);
+    EXPECT_EQ(lazy.pop().second, 2);  // past the tombstones of 0 and 1
+    stats = lazy.stats();
+    EXPECT_EQ(stats.tombstones_skipped, 2);
+    EXPECT_EQ(stats.size, 8);
+    EXPECT_EQ(stats.heap_size, 8);
+    EXPECT_EQ(stats.index.keys, 8);
+    EXPECT_GE(stats.index.max_probe, 1);
+    lazy.remove(3);
+    lazy.compact();
+    EXPECT_EQ(lazy.stats().compactions, 1);
+    EXPECT_EQ(lazy.stats().heap_size, 7);
+}
+#endif
+
+#ifdef __cpp_lib_memory_resource
+namespace {
+    // counts what is still allocated from it
+    class CountingResource: public std::pmr::memory_resource {
+    public:
+        std::size_t allocations{0}, outstanding{0};
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t align) override {
+            ++allocations;
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+}
+
+template<typename QT>
+void test_queue_resource() {
+    CountingResource resource;
+    {
+        QT q{&resource};
+        for (int i = 0; i < 1000; ++i) { q.push(i, i); }
+        q.remove(3);
+        q.reschedule(4, -1);
+        EXPECT_EQ(q.pop().second, 4);
+        EXPECT_GT(resource.allocations, 0);
+        EXPECT_EQ(q.get_allocator().resource(), &resource);
+    }
+    EXPECT_EQ(resource.outstanding, 0);
+}
+
+TEST(hq_test, test_pmr) {
+    test_queue_resource<pmr::EagerQueue<int>>();
+    test_queue_resource<pmr::EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4, double,
+            std::less<double>, DynamicIdOf<int, int>, FlatIndex>>();
+    test_queue_resource<pmr::LazyQueue<int>>();
+    test_queue_resource<pmr::LazyQueue<int, int, std::hash<int>, std::equal_to<int>, double,
+            std::less<double>, DynamicIdOf<int, int>, FlatIndex>>();
+
+    // a monotonic arena takes the whole per-request queue, and is released at once
+    std::array<std::byte, 1 << 16> buffer{};
+    std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size(), std::pmr::null_memory_resource()};
+    pmr::EagerQueue<int> q{&arena};
+    for (int i = 0; i < 100; ++i) { q.push(100 - i, i); }
+    for (int i = 99; i >= 0; --i) { EXPECT_EQ(q.pop().second, i); }
+}
+#endif
+
+template<typename QT>
+std::vector<std::pair<double, int>> drain(QT& q) {
+    std::vector<std::pair<double, int>> out;
+    q.pop_n(q.size(), std::back_inserter(out));
+    return out;
+}
+
+template<typename QT>
+void test_move_merge_queue() {
+    auto make = [](int first, int last) {  // a factory returning by value
+        QT q;
+        for (int i = first; i < last; ++i) { q.push((i * 37) % 101, i); }
+        return q;
+    };
+    std::vector<QT> shards;
+    for (int s = 0; s < 8; ++s) { shards.push_back(make(s * 100, s * 100 + 100)); }  // reallocations move them
+    shards[3].remove(350);
+    shards[3] = make(1000, 1010);  // on top of a non-empty queue
+    EXPECT_EQ(shards[3].size(), 10);
+    QT moved{std::move(shards[0])};
+    EXPECT_EQ(shards[0].size(), 0);
+    EXPECT_EQ(moved.size(), 100);
+    shards[0].push(7, 4242);  // a moved-from queue is empty and usable
+    EXPECT_EQ(shards[0].pop(), std::make_pair(7.0, 4242));
+
+    std::vector<std::pair<double, int>> expected;
+    auto expect_all = [&](QT& q) {
+        for (auto& [time, id]: drain(q)) { expected.emplace_back(time, id); }
+    };
+    QT big = make(2000, 2500);
+    QT small = make(3000, 3010);
+    QT scratch = make(2000, 2500);
+    expect_all(scratch);
+    scratch = make(3000, 3010);
+    expect_all(scratch);
+    for (int i = 3010; i < 3500; ++i) { small.push(i % 13, i); }
+    scratch = make(0, 0);
+    for (int i = 3010; i < 3500; ++i) { scratch.push(i % 13, i); }
+    expect_all(scratch);
+
+    big.merge(small);  // about as large: heapified whole
+    EXPECT_EQ(small.size(), 0);
+    QT tiny = make(4000, 4003);
+    big.merge(tiny);  // sifted up
+    scratch = make(4000, 4003);
+    expect_all(scratch);
+    big.reschedule(2001, -5);
+    EXPECT_EQ(big.size(), expected.size());
+    auto merged = drain(big);
+    ASSERT_EQ(merged.size(), expected.size());
+    EXPECT_EQ(merged.front(), std::make_pair(-5.0, 2001));
+    EXPECT_TRUE(std::is_sorted(merged.begin(), merged.end(),
+                               [](const auto& a, const auto& b) { return a.first < b.first; }));
+    std::sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+    for (std::size_t i = 0; i < merged.size(); ++i) {
+        EXPECT_EQ(merged[i].second, expected[i].second);
+        if (merged[i].second != 2001) { EXPECT_EQ(merged[i].first, expected[i].first); }
+    }
+}
+
+TEST(hq_test, test_move_merge) {
+    test_move_merge_queue<EagerQueue<int>>();
+    test_move_merge_queue<EagerQueue<int, int, std::hash<int>, std::equal_to<int>, 4, double, std::less<double>,
+            DynamicIdOf<int, int>, FlatIndex>>();
+    test_move_merge_queue<LazyQueue<int>>();
+    test_move_merge_queue<PairingQueue<int>>();
+
+    // tombstones of a lazy queue are dropped by the merge
+    LazyQueue<int> a, b;
+    for (int i = 0; i < 100; ++i) { b.push(i, i); }
+    for (int i = 0; i < 50; ++i) { b.reschedule(i, 200 + i); }
+    b.remove(99);
+    a.push(-1, -1);
+    a.merge(b);
+    EXPECT_EQ(a.size(), 100);
+    EXPECT_EQ(a.pop().second, -1);
+    EXPECT_EQ(a.pop().second, 50);
+
+    // queues sharing a pool hand their entries over as they are
+    EagerQueue<int>::pool_type pool;
+    EagerQueue<int> p{pool}, q{pool};
+    for (int i = 0; i < 10; ++i) { p.push(i, i); q.push(i + 0.5, i + 10); }
+    const auto capacity = pool.capacity();
+    p.merge(q);
+    EXPECT_EQ(pool.capacity(), capacity);
+    EXPECT_EQ(p.size(), 20);
+    EXPECT_EQ(drain(p).back(), std::make_pair(9.5, 19));
+}
+
+#ifdef __cpp_lib_memory_resource
+TEST(hq_test, test_move_merge_pmr) {
+    // across resources entries cannot change hands; they are rebuilt in the target's resource
+    CountingResource first, second;
+    {
+        pmr::EagerQueue<int> a{&first};
+        pmr::LazyQueue<int> lazy_a{&first};
+        {
+            pmr::EagerQueue<int> b{&second};
+            pmr::LazyQueue<int> lazy_b{&second};
+            for (int i = 0; i < 500; ++i) {
+                b.push(i, i);
+                lazy_b.push(i, i);
+            }
+            lazy_b.remove(0);
+            a.push(-1, -1);
+            a.merge(b);
+            lazy_a.merge(lazy_b);
+            EXPECT_EQ(b.size(), 0);
+            EXPECT_EQ(a.size(), 501);
+            EXPECT_EQ(lazy_a.size(), 499);
+            b.push(1000, 1000);
+            a = std::move(b);  // a's own pool is drawn from first, so this rebuilds too
+            EXPECT_EQ(a.size(), 1);
+        }
+        EXPECT_EQ(second.outstanding, 0);
+        EXPECT_EQ(a.pop(), std::make_pair(1000.0, 1000));
+        EXPECT_EQ(lazy_a.pop().second, 1);
+        EXPECT_EQ(a.get_allocator().resource(), &first);
+        pmr::EagerQueue<int> c{std::move(a)};  // a move construction keeps the resource
+        EXPECT_EQ(c.get_allocator().resource(), &first);
+    }
+    EXPECT_EQ(first.outstanding, 0);
+}
+#endif
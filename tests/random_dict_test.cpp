@@ -1,4 +1,17 @@
 #include "gtest/gtest.h"
+#include <thread>
+#include <string_view>
+#include <sstream>
+#include <fstream>
+#include <cstdio>
+#include <iterator>
+#include <unordered_set>
+#include <atomic>
+#include <numeric>
+#include <string>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include "randomdict.h"
 using namespace data_structures;
 
@@ -138,3 +151,706 @@ TEST(rs_test, test_seeding) {
         EXPECT_EQ(rs3.erase(rs3.random_elem()), 1);
     }
 }
+
+TEST(frd_test, test_simple) {
+    FlatRandomDict<std::string, int> rd(123);
+    EXPECT_ANY_THROW(rd.random_pair());
+    std::vector letters {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+    for (std::size_t i = 0; i < letters.size(); ++i) {
+        rd[letters[i]] = static_cast<int>(i);
+    }
+    EXPECT_EQ(rd.count("c"), 1);
+    EXPECT_EQ(rd.size(), letters.size());
+    EXPECT_EQ(rd.insert("a", 666), 0);  // no-op for dup
+    EXPECT_EQ(rd.emplace(std::forward_as_tuple("k"), std::forward_as_tuple(10)), 1);
+    std::pair<std::string, int> p = rd.random_pair();
+    rd[p.first] = 666;
+    EXPECT_EQ(rd.at(p.first), 666);
+
+    p = rd.random_pair();
+    EXPECT_EQ(rd.erase(p.first), 1);
+    EXPECT_EQ(rd.count(p.first), 0);
+    EXPECT_ANY_THROW(rd.at(p.first));
+    rd[p.first] = 777;
+    EXPECT_EQ(rd.at(p.first), 777);
+}
+
+TEST(frs_test, test_random_ops) {  // checked against RandomSet, sharing its seed
+    RandomSet<int> rs{42};
+    FlatRandomSet<int> frs{42};
+    FlatRandomDict<int, int> frd{42};
+    std::mt19937 rng(7);
+    for (int i = 0; i < 20000; ++i) {
+        int key = static_cast<int>(rng() % 3000);
+        if (rng() % 3) {
+            EXPECT_EQ(frs.insert(key), rs.insert(key));
+            frd.insert(key, -key);
+        } else {
+            EXPECT_EQ(frs.erase(key), rs.erase(key));
+            frd.erase(key);
+        }
+        ASSERT_EQ(frs.size(), rs.size());
+        ASSERT_EQ(frd.size(), rs.size());
+    }
+    for (int key = 0; key < 3000; ++key) {
+        ASSERT_EQ(frs.count(key), rs.count(key));
+        ASSERT_EQ(frd.count(key), rs.count(key));
+        if (frd.count(key)) { EXPECT_EQ(frd.at(key), -key); }
+    }
+    auto copy = frs;  // no pointers inside; plain copies work
+    while (frs.size()) {
+        const int key = frs.random_elem();
+        EXPECT_EQ(copy.random_elem(), key);
+        EXPECT_EQ(rs.erase(key), 1);
+        EXPECT_EQ(frs.erase(key), 1);
+        EXPECT_EQ(copy.erase(key), 1);
+    }
+    EXPECT_EQ(rs.size(), 0);
+    frs.clear();
+    EXPECT_ANY_THROW(frs.random_elem());
+}
+
+template<typename Set>
+void test_set_sampling() {
+    Set rs{123};
+    std::vector<int> out;
+    EXPECT_ANY_THROW(rs.sample(1, std::back_inserter(out)));
+    rs.sample_distinct(3, std::back_inserter(out));
+    EXPECT_TRUE(out.empty());
+    for (int i = 0; i < 100; ++i) {
+        rs.insert(i);
+    }
+    rs.sample(1000, std::back_inserter(out));
+    EXPECT_EQ(out.size(), 1000);
+    std::unordered_set<int> seen(out.begin(), out.end());
+    EXPECT_GT(seen.size(), 90);  // 1000 draws out of 100 miss ~0.004% of the keys
+    for (std::size_t k: {0, 10, 50, 51, 99, 100, 150}) {  // both Floyd's and Fisher-Yates, and k > size()
+        out.clear();
+        rs.sample_distinct(k, std::back_inserter(out));
+        EXPECT_EQ(out.size(), std::min<std::size_t>(k, 100));
+        std::unordered_set<int> distinct(out.begin(), out.end());
+        EXPECT_EQ(distinct.size(), out.size());
+        for (int key: out) {
+            EXPECT_EQ(rs.count(key), 1);
+        }
+    }
+}
+
+TEST(rs_test, test_sampling) {
+    test_set_sampling<RandomSet<int>>();
+    test_set_sampling<FlatRandomSet<int>>();
+    RandomDict<int, int> rd{1};
+    FlatRandomDict<int, int> frd{1};
+    for (int i = 0; i < 10; ++i) {
+        rd[i] = -i;
+        frd[i] = -i;
+    }
+    std::vector<std::pair<int, int>> pairs;
+    rd.sample(5, std::back_inserter(pairs));
+    frd.sample_distinct(10, std::back_inserter(pairs));
+    EXPECT_EQ(pairs.size(), 15);
+    for (const auto& [key, val]: pairs) {
+        EXPECT_EQ(val, -key);
+    }
+}
+
+TEST(wrd_test, test_weights) {
+    WeightedRandomDict<std::string, int> wrd{123};
+    EXPECT_ANY_THROW(wrd.random_pair());
+    EXPECT_ANY_THROW(wrd.insert("bad", 0, -1.0));
+    EXPECT_EQ(wrd.insert("zero", 0, 0.0), 1);
+    EXPECT_ANY_THROW(wrd.random_pair());  // nothing to pick from
+    EXPECT_EQ(wrd.insert("a", 1, 1.0), 1);
+    EXPECT_EQ(wrd.insert("a", 10, 5.0), 0);  // no-op for dup
+    EXPECT_EQ(wrd.emplace(std::forward_as_tuple("b"), std::forward_as_tuple(2), 3.0), 1);
+    EXPECT_EQ(wrd.insert("c", 3, 6.0), 1);
+    EXPECT_DOUBLE_EQ(wrd.total_weight(), 10.0);
+    std::unordered_map<std::string, int> hits;
+    const int draws = 20000;
+    for (int i = 0; i < draws; ++i) {
+        hits[wrd.random_pair().first]++;
+    }
+    EXPECT_EQ(hits.count("zero"), 0);
+    EXPECT_NEAR(hits["a"] / static_cast<double>(draws), 0.1, 0.02);
+    EXPECT_NEAR(hits["b"] / static_cast<double>(draws), 0.3, 0.02);
+    EXPECT_NEAR(hits["c"] / static_cast<double>(draws), 0.6, 0.02);
+
+    wrd.set_weight("zero", 4.0);
+    EXPECT_EQ(wrd.erase("c"), 1);
+    EXPECT_EQ(wrd.erase("a"), 1);  // moves the last entry around
+    EXPECT_DOUBLE_EQ(wrd.total_weight(), 7.0);
+    EXPECT_DOUBLE_EQ(wrd.weight("b"), 3.0);
+    hits.clear();
+    for (int i = 0; i < draws; ++i) {
+        hits[wrd.random_pair().first]++;
+    }
+    EXPECT_NEAR(hits["zero"] / static_cast<double>(draws), 4.0 / 7.0, 0.02);
+    auto copy = wrd;
+    EXPECT_EQ(copy.at("b"), 2);
+    EXPECT_EQ(copy.random_pair(), wrd.random_pair());
+}
+
+TEST(wrd_test, test_zeroed) {
+    // weights of wildly different scales, so that every delta added to the tree rounds
+    WeightedRandomDict<int, int> wrd{5};
+    std::mt19937 rng(3);
+    for (int i = 0; i < 500; ++i) { wrd.insert(i, i, 0.1 * (i + 1)); }
+    for (int round = 0; round < 20000; ++round) {
+        const int key = static_cast<int>(rng() % 500);
+        wrd.set_weight(key, rng() % 2 ? 1e12 * (rng() % 7) : 1e-3 * (rng() % 13));
+    }
+    for (int i = 0; i < 500; ++i) {
+        if (i % 100 != 7) { wrd.set_weight(i, 0.0); }
+    }
+    wrd.set_weight(107, 1e-9);
+    wrd.set_weight(207, 1e-9);
+    for (int draw = 0; draw < 2000; ++draw) {  // zero weights are never drawn
+        EXPECT_EQ(wrd.random_pair().first % 100, 7);
+    }
+    for (int i = 7; i < 500; i += 100) { wrd.set_weight(i, 0.0); }
+    EXPECT_EQ(wrd.total_weight(), 0.0);
+    EXPECT_THROW(wrd.random_pair(), std::runtime_error);
+    wrd.set_weight(42, 2.0);
+    EXPECT_DOUBLE_EQ(wrd.total_weight(), 2.0);
+    EXPECT_EQ(wrd.pop_random().first, 42);
+    EXPECT_THROW(wrd.pop_random(), std::runtime_error);
+}
+
+TEST(wrd_test, test_against_linear_scan) {
+    WeightedRandomDict<int, int> wrd{7};
+    std::mt19937 rng(9);
+    for (int i = 0; i < 1000; ++i) {
+        wrd.insert(i, i, static_cast<double>(rng() % 10));
+    }
+    for (int i = 0; i < 3000; ++i) {
+        const int key = static_cast<int>(rng() % 1000);
+        if (rng() % 2) {
+            wrd.erase(key);
+        } else if (wrd.count(key)) {
+            wrd.set_weight(key, static_cast<double>(rng() % 10));
+        } else {
+            wrd.insert(key, key, static_cast<double>(rng() % 10));
+        }
+    }
+    double total = 0;
+    for (int key = 0; key < 1000; ++key) {
+        if (wrd.count(key)) { total += wrd.weight(key); }
+    }
+    EXPECT_DOUBLE_EQ(wrd.total_weight(), total);
+    for (int i = 0; i < 1000; ++i) {
+        EXPECT_GT(wrd.weight(wrd.random_pair().first), 0);
+    }
+}
+
+TEST(frd_test, test_snapshot) {
+    FlatRandomDict<int, int> frd{5};
+    const int n = 20000;  // spans several chunks
+    for (int i = 0; i < n; ++i) { frd[i] = i; }
+    auto snap = frd.snapshot();
+    for (int i = 0; i < n; i += 2) { EXPECT_EQ(frd.erase(i), 1); }
+    for (int i = 1; i < n; i += 4) { frd.at(i) = -i; }
+    frd[n] = n;
+    EXPECT_EQ(snap.size(), n);
+    EXPECT_EQ(frd.size(), n / 2 + 1);
+    for (int i = 0; i < n; ++i) {
+        EXPECT_EQ(snap.at(i), i);  // untouched by the writes above
+    }
+    EXPECT_EQ(snap.count(n), 0);
+    for (int i = 0; i < 1000; ++i) {
+        auto [key, val] = frd.random_pair();
+        EXPECT_EQ(key % 2, 1);
+        EXPECT_EQ(val, key % 4 == 1 ? -key : key);
+    }
+    snap.erase(1);  // and the other way around
+    EXPECT_EQ(frd.at(1), -1);
+    EXPECT_EQ(snap.count(1), 0);
+}
+
+TEST(frs_test, test_concurrent_snapshot) {
+    FlatRandomSet<int> frs{11};
+    for (int i = 0; i < 10000; ++i) { frs.insert(i); }
+    auto snap = frs.snapshot();
+    std::thread reader([snap = std::move(snap)]() mutable {
+        for (int i = 0; i < 20000; ++i) {
+            const int key = snap.random_elem();
+            ASSERT_TRUE(key >= 0 && key < 10000);
+            ASSERT_EQ(snap.count(key), 1);
+        }
+    });
+    for (int i = 0; i < 10000; ++i) {  // the writer keeps going meanwhile
+        frs.erase(i);
+        frs.insert(i + 10000);
+    }
+    reader.join();
+    EXPECT_EQ(frs.size(), 10000);
+    EXPECT_EQ(frs.count(0), 0);
+}
+
+TEST(rs_test, test_capacity) {
+    RandomSet<int> rs{3};
+    rs.reserve(1000);
+    EXPECT_GE(rs.bucket_count() * rs.max_load_factor(), 1000);
+    const std::size_t buckets = rs.bucket_count();
+    for (int i = 0; i < 1000; ++i) { rs.insert(i); }
+    EXPECT_EQ(rs.bucket_count(), buckets);  // no rehash during the bulk load
+    const int* p = &rs.random_elem();
+    const int kept = *p;
+    rs.max_load_factor(0.25f);  // forces a rehash
+    rs.rehash(10000);
+    EXPECT_GE(rs.bucket_count(), 10000);
+    EXPECT_EQ(*p, kept);  // the nodes stayed put, and v was re-pointed at them
+    for (int i = 0; i < 1000; ++i) {
+        if (i != kept) { rs.erase(i); }
+    }
+    rs.shrink_to_fit();
+    EXPECT_LT(rs.bucket_count(), 100);
+    EXPECT_EQ(&rs.random_elem(), p);
+    EXPECT_EQ(rs.size(), 1);
+}
+
+namespace {
+    // not noexcept, so the node-based tables keep each node's hash code rather than calling this again
+    struct CountingHash {
+        static inline std::size_t calls = 0;
+        std::size_t operator()(int x) const { ++calls; return std::hash<int>{}(x); }
+    };
+}
+
+TEST(rs_test, test_pop_across_rehash) {  // v's iterators stay valid as the table grows and shrinks
+    RandomSet<int, CountingHash> rs{5};
+    RandomDict<int, int, CountingHash> rd{5};
+    const int n = 5000;
+    for (int i = 0; i < n; ++i) {
+        rs.insert(i);
+        rd.insert(i, -i);
+        if (i % 1000 == 999) { rs.rehash(0); rd.max_load_factor(0.5f + 0.1f * static_cast<float>(i / 1000)); }
+    }
+    std::unordered_set<int> popped;
+    const std::size_t hashed = CountingHash::calls;
+    for (int i = 0; i < n / 2; ++i) {
+        EXPECT_TRUE(popped.insert(rs.pop_random()).second);
+        auto [key, val] = rd.pop_random();
+        EXPECT_EQ(val, -key);
+    }
+#if defined(__GLIBCXX__) || defined(_LIBCPP_VERSION)
+    EXPECT_EQ(CountingHash::calls, hashed);  // unlinked through the stored iterators
+#endif
+    rs.shrink_to_fit();
+    rd.shrink_to_fit();
+    for (int i = 0; i < n; ++i) { EXPECT_EQ(rs.count(i), !popped.count(i)); }
+    while (rs.size()) { EXPECT_TRUE(popped.insert(rs.pop_random()).second); }
+    while (rd.size()) { rd.pop_random(); }
+    EXPECT_EQ(popped.size(), n);
+}
+
+TEST(rd_test, test_capacity) {
+    RandomDict<std::string, int> rd{3};
+    WeightedRandomDict<std::string, int> wrd{3};
+    FlatRandomDict<std::string, int> frd{3};
+    rd.reserve(500);
+    wrd.reserve(500);
+    frd.reserve(500);
+    for (int i = 0; i < 500; ++i) {
+        rd[std::to_string(i)] = i;
+        wrd.insert(std::to_string(i), i, 1.0);
+        frd[std::to_string(i)] = i;
+    }
+    rd.max_load_factor(2.0f);
+    EXPECT_FLOAT_EQ(rd.max_load_factor(), 2.0f);
+    for (int i = 0; i < 490; ++i) {
+        rd.erase(std::to_string(i));
+        wrd.erase(std::to_string(i));
+    }
+    rd.shrink_to_fit();
+    wrd.shrink_to_fit();
+    EXPECT_LE(rd.load_factor(), 2.0f);
+    for (int i = 490; i < 500; ++i) {
+        EXPECT_EQ(rd.at(std::to_string(i)), i);
+        EXPECT_EQ(wrd.at(std::to_string(i)), i);
+        EXPECT_EQ(frd.at(std::to_string(i)), i);
+    }
+    EXPECT_DOUBLE_EQ(wrd.total_weight(), 10.0);
+    auto [key, val] = rd.random_pair();
+    EXPECT_EQ(std::to_string(val), key);
+}
+
+namespace {
+    struct Token {  // not convertible to std::string
+        std::string_view name;
+    };
+    struct TokenHash {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+        std::size_t operator()(const Token& t) const { return (*this)(t.name); }
+    };
+    struct TokenEqual {
+        using is_transparent = void;
+        static std::string_view view(std::string_view s) { return s; }
+        static std::string_view view(const Token& t) { return t.name; }
+        template<typename A, typename B>
+        bool operator()(const A& a, const B& b) const { return view(a) == view(b); }
+    };
+}
+
+template<typename Dict>
+void test_dict_transparent() {
+    Dict d{1};
+    d["alpha"] = 1;
+    d["beta"] = 2;
+    EXPECT_EQ(d.count(Token{"alpha"}), 1);
+    EXPECT_EQ(d.count(Token{"gamma"}), 0);
+    EXPECT_EQ(d.at(Token{"beta"}), 2);
+    EXPECT_ANY_THROW(d.at(Token{"gamma"}));
+    EXPECT_EQ(d.erase(Token{"alpha"}), 1);
+    EXPECT_EQ(d.erase(Token{"alpha"}), 0);
+    EXPECT_EQ(d.size(), 1);
+    EXPECT_EQ(d.erase(std::string("beta")), 1);  // the key type still works
+}
+
+TEST(frd_test, test_transparent) {
+    test_dict_transparent<FlatRandomDict<std::string, int, TokenHash, TokenEqual>>();
+    FlatRandomSet<std::string, TokenHash, TokenEqual> frs{1};
+    frs.insert("alpha");
+    EXPECT_EQ(frs.count(Token{"alpha"}), 1);
+    EXPECT_EQ(frs.erase(Token{"alpha"}), 1);
+#ifdef __cpp_lib_generic_unordered_lookup
+    test_dict_transparent<RandomDict<std::string, int, TokenHash, TokenEqual>>();
+    RandomSet<std::string, TokenHash, TokenEqual> rs{1};
+    rs.insert("alpha");
+    EXPECT_EQ(rs.count(Token{"alpha"}), 1);
+    EXPECT_EQ(rs.erase(Token{"alpha"}), 1);
+    WeightedRandomDict<std::string, int, TokenHash, TokenEqual> wrd{1};
+    wrd.insert("alpha", 1, 2.0);
+    wrd.set_weight(Token{"alpha"}, 3.0);
+    EXPECT_EQ(wrd.weight(Token{"alpha"}), 3.0);
+    EXPECT_EQ(wrd.at(Token{"alpha"}), 1);
+    EXPECT_EQ(wrd.erase(Token{"alpha"}), 1);
+#endif
+}
+
+template<typename Set>
+void test_set_bulk() {
+    Set s{17};
+    std::vector<int> keys;
+    for (int i = 0; i < 1000; ++i) { keys.push_back(i % 800); }  // with duplicates
+    EXPECT_EQ(s.insert(keys.begin(), keys.end()), 800);
+    EXPECT_EQ(s.size(), 800);
+    std::vector<int> gone;
+    for (int i = 0; i < 800; i += 3) { gone.push_back(i); }
+    gone.push_back(5000);  // absent
+    gone.push_back(0);  // twice
+    EXPECT_EQ(s.erase(gone.begin(), gone.end()), 267);
+    EXPECT_EQ(s.size(), 533);
+    std::unordered_set<int> popped;
+    while (s.size()) {
+        const int key = s.pop_random();
+        EXPECT_NE(key % 3, 0);
+        EXPECT_TRUE(popped.insert(key).second);
+        EXPECT_EQ(s.count(key), 0);
+    }
+    EXPECT_EQ(popped.size(), 533);
+    EXPECT_ANY_THROW(s.pop_random());
+}
+
+template<typename Dict>
+void test_dict_bulk() {
+    Dict d{17};
+    std::vector<std::pair<std::string, int>> kvs;
+    for (int i = 0; i < 300; ++i) { kvs.emplace_back(std::to_string(i), i); }
+    EXPECT_EQ(d.insert(kvs.begin(), kvs.end()), 300);
+    EXPECT_EQ(d.insert(kvs.begin(), kvs.begin() + 10), 0);
+    std::vector<std::string> gone{"0", "1", "2", "299", "nope"};
+    EXPECT_EQ(d.erase(gone.begin(), gone.end()), 4);
+    int total = 0;
+    while (d.size()) {
+        auto [key, val] = d.pop_random();
+        EXPECT_EQ(std::to_string(val), key);
+        EXPECT_EQ(d.count(key), 0);
+        total += val;
+        if (d.size()) {  // the rest is still intact
+            auto [k, v] = d.random_pair();
+            EXPECT_EQ(std::to_string(v), k);
+        }
+    }
+    EXPECT_EQ(total, 299 * 300 / 2 - 3 - 299);
+    EXPECT_ANY_THROW(d.pop_random());
+}
+
+TEST(rs_test, test_bulk) {
+    test_set_bulk<RandomSet<int>>();
+    test_set_bulk<FlatRandomSet<int>>();
+    std::istringstream in("3 1 4 1 5");  // single pass
+    RandomSet<int> rs{1};
+    EXPECT_EQ(rs.insert(std::istream_iterator<int>(in), std::istream_iterator<int>()), 4);
+
+    // two const char* build one key in place, rather than read as a range of chars
+    RandomSet<std::string> words{1};
+    const char* hello = "hello";
+    EXPECT_EQ(words.insert(hello, hello + 5), 1);
+    EXPECT_EQ(words.size(), 1);
+    EXPECT_EQ(words.count("hello"), 1);
+    FlatRandomSet<std::string> flat_words{1};
+    EXPECT_EQ(flat_words.insert(hello, hello + 4), 1);
+    EXPECT_EQ(flat_words.count("hell"), 1);
+    std::vector<std::string> more{"hello", "world"};
+    EXPECT_EQ(words.insert(more.begin(), more.end()), 1);
+}
+
+TEST(rd_test, test_bulk) {
+    test_dict_bulk<RandomDict<std::string, int>>();
+    test_dict_bulk<FlatRandomDict<std::string, int>>();
+    RandomDict<std::string, std::string> names{1};
+    const char* key = "key";
+    const char* val = "value";
+    EXPECT_EQ(names.insert(key, val), 1);  // a key and a value, not a range
+    EXPECT_EQ(names.at("key"), "value");
+    WeightedRandomDict<std::string, int> wrd{1};
+    wrd.insert("never", 0, 0.0);
+    for (int i = 1; i <= 50; ++i) { wrd.insert(std::to_string(i), i, 1.0); }
+    for (int i = 1; i <= 50; ++i) {
+        auto [key, val] = wrd.pop_random();
+        EXPECT_NE(key, "never");
+        EXPECT_EQ(std::to_string(val), key);
+    }
+    EXPECT_EQ(wrd.size(), 1);
+    EXPECT_ANY_THROW(wrd.pop_random());  // only zero weight left
+}
+
+TEST(frd_test, test_image) {
+    FlatRandomDict<int, double> frd{1};
+    const int n = 10000;
+    for (int i = 0; i < n; ++i) { frd.insert(i, i * 0.5); }
+    for (int i = 0; i < n; i += 7) { frd.erase(i); }
+    std::stringstream image;
+    frd.save(image);
+
+    auto loaded = FlatRandomDict<int, double>::load(image, 2);
+    EXPECT_EQ(loaded.size(), frd.size());
+    for (int i = 0; i < n; ++i) {
+        ASSERT_EQ(loaded.count(i), frd.count(i));
+        if (loaded.count(i)) { EXPECT_EQ(loaded.at(i), i * 0.5); }
+    }
+
+    const std::string path = testing::TempDir() + "frd_test_image.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        frd.save(out);
+    }
+    auto mapped = FlatRandomDict<int, double>::map(path, 3);
+    EXPECT_EQ(mapped.size(), frd.size());
+    auto [key, val] = mapped.random_pair();
+    EXPECT_EQ(val, key * 0.5);
+    // writes copy the chunks they touch out of the mapping
+    mapped.at(1) = -1;
+    mapped.erase(2);
+    mapped.insert(n, 0.0);
+    std::vector<int> gone;
+    for (int i = 3; i < n; i += 2) { gone.push_back(i); }
+    mapped.erase(gone.begin(), gone.end());
+    EXPECT_EQ(mapped.at(1), -1);
+    EXPECT_EQ(mapped.count(2), 0);
+    EXPECT_EQ(mapped.at(n), 0.0);
+    auto reloaded = FlatRandomDict<int, double>::map(path, 4);  // the file is untouched
+    EXPECT_EQ(reloaded.at(1), 0.5);
+    EXPECT_EQ(reloaded.size(), frd.size());
+    std::remove(path.c_str());
+
+    std::stringstream empty;
+    FlatRandomSet<int>{1}.save(empty);
+    auto none = FlatRandomSet<int>::load(empty, 1);
+    EXPECT_EQ(none.size(), 0);
+    none.insert(5);
+    EXPECT_EQ(none.random_elem(), 5);
+}
+
+namespace {
+    struct OtherHash {
+        std::size_t operator()(int x) const { return std::hash<int>{}(x) + 1; }
+    };
+}
+
+TEST(frs_test, test_image_mismatch) {
+    FlatRandomSet<int> frs{1};
+    for (int i = 0; i < 100; ++i) { frs.insert(i); }
+    std::stringstream image;
+    frs.save(image);
+    const std::string bytes = image.str();
+    std::stringstream other_hash(bytes);
+    EXPECT_ANY_THROW((FlatRandomSet<int, OtherHash>::load(other_hash, 1)));
+    std::stringstream other_type(bytes);
+    EXPECT_ANY_THROW((FlatRandomSet<std::uint64_t>::load(other_type, 1)));
+    std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+    EXPECT_ANY_THROW(FlatRandomSet<int>::load(truncated, 1));
+    std::stringstream garbage("definitely not an image");
+    EXPECT_ANY_THROW(FlatRandomSet<int>::load(garbage, 1));
+
+    // a whole header but not its padding, mapped from a file
+    const std::string path = testing::TempDir() + "frs_test_truncated.bin";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(bytes.data(), 60);
+    }
+    EXPECT_THROW(FlatRandomSet<int>::map(path, 1), std::runtime_error);
+    std::remove(path.c_str());
+
+    // dense indices out of range in the table, which follows the header and the padded dense array
+    std::string corrupt = bytes;
+    const std::size_t table = 64 + (100 * sizeof(int) + 63) / 64 * 64;
+    std::fill(corrupt.begin() + static_cast<std::ptrdiff_t>(table),
+              corrupt.begin() + static_cast<std::ptrdiff_t>(table + 128 * sizeof(std::size_t)), '\xff');
+    std::stringstream bad_table(corrupt);
+    EXPECT_THROW(FlatRandomSet<int>::load(bad_table, 1), std::invalid_argument);
+}
+
+#ifdef DATA_STRUCTURES_ENABLE_STATS
+TEST(rd_test, test_stats) {
+    RandomSet<int> rs{1};
+    for (int i = 0; i < 100; ++i) { rs.insert(i); }
+    rs.insert(0);  // present already
+    rs.erase(99);  // the last entry; nothing to move
+    rs.erase(0);
+    rs.random_elem();
+    std::vector<int> out;
+    rs.sample(5, std::back_inserter(out));
+    rs.sample_distinct(500, std::back_inserter(out));
+    auto stats = rs.stats();
+    EXPECT_EQ(stats.inserts, 100);
+    EXPECT_EQ(stats.erases, 2);
+    EXPECT_EQ(stats.hole_fills, 1);
+    EXPECT_EQ(stats.draws, 1 + 5 + 98);
+    EXPECT_EQ(stats.size, 98);
+    EXPECT_GE(stats.capacity, 98);
+    EXPECT_EQ(stats.index.keys, 98);
+    EXPECT_EQ(stats.index.slots, rs.bucket_count());
+    EXPECT_GE(stats.index.mean_probe, 1.0);
+    rs.reset_stats();
+    EXPECT_EQ(rs.stats().inserts, 0);
+
+    RandomDict<std::string, int> rd{1};
+    rd["a"] = 1;
+    rd.insert("b", 2);
+    rd.emplace(std::forward_as_tuple("c"), std::forward_as_tuple(3));
+    rd.pop_random();
+    rd.random_pair();
+    stats = rd.stats();
+    EXPECT_EQ(stats.inserts, 3);
+    EXPECT_EQ(stats.erases, 1);
+    EXPECT_EQ(stats.draws, 1);
+    EXPECT_EQ(stats.index.keys, 2);
+}
+#endif
+
+#ifdef __cpp_lib_memory_resource
+namespace {
+    // counts what is still allocated from it
+    class CountingResource: public std::pmr::memory_resource {
+    public:
+        std::size_t allocations{0}, outstanding{0};
+    private:
+        void* do_allocate(std::size_t bytes, std::size_t align) override {
+            ++allocations;
+            outstanding += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, align);
+        }
+        void do_deallocate(void* p, std::size_t bytes, std::size_t align) override {
+            outstanding -= bytes;
+            std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+}
+
+TEST(rd_test, test_pmr) {
+    CountingResource first, second;
+    {
+        const std::vector<int> keys{1, 2, 3, 4, 5};
+        pmr::RandomSet<int> rs{1, &first};
+        rs.insert(keys.begin(), keys.end());
+        rs.erase(keys.begin(), keys.begin() + 2);
+        EXPECT_EQ(rs.size(), 3);
+        EXPECT_GT(first.outstanding, 0);
+        pmr::RandomSet<int> copy{rs};
+        EXPECT_EQ(copy.size(), 3);
+    }
+    EXPECT_EQ(first.outstanding, 0);
+    {
+        // the keys and values are std::pmr::strings and take the container's resource too
+        pmr::RandomDict<std::pmr::string, std::pmr::string> rd{1, &first};
+        for (int i = 0; i < 100; ++i) {
+            rd.insert(std::pmr::string(std::to_string(i) + " is a key too long for the small buffer"),
+                      std::pmr::string(std::to_string(i) + " is a value too long for the small buffer"));
+        }
+        const std::size_t allocations = first.allocations;
+        EXPECT_GE(allocations, 300);  // a node, a key and a value each
+        EXPECT_EQ(rd.random_pair().second.get_allocator().resource(), &first);
+        rd.erase(rd.random_pair().first);
+
+        pmr::RandomDict<std::pmr::string, std::pmr::string> other{2, &second};
+        other = std::move(rd);  // different resources: the entries are copied into second
+        EXPECT_EQ(other.size(), 99);
+        EXPECT_EQ(other.get_allocator().resource(), &second);
+        EXPECT_EQ(other.random_pair().first.get_allocator().resource(), &second);
+        EXPECT_EQ(rd.size(), 0);
+        for (int i = 0; i < 100; ++i) {
+            const std::pmr::string key{std::to_string(i) + " is a key too long for the small buffer"};
+            if (other.count(key)) {
+                EXPECT_EQ(std::string_view(other.at(key)), std::to_string(i) + " is a value too long for the small buffer");
+            }
+        }
+
+        pmr::RandomDict<std::pmr::string, std::pmr::string> moved{std::move(other)};  // takes the resource along
+        EXPECT_EQ(moved.size(), 99);
+        EXPECT_EQ(moved.get_allocator().resource(), &second);
+    }
+    EXPECT_EQ(first.outstanding, 0);
+    EXPECT_EQ(second.outstanding, 0);
+}
+#endif
+
+TEST(rd_test, test_iteration) {
+    RandomDict<int, long> rd{1};
+    const int n = 100000;
+    for (int i = 0; i < n; ++i) { rd.insert(i, i); }
+    for (int i = 0; i < n; i += 3) { rd.erase(i); }
+
+    long expected = 0;
+    for (int i = 0; i < n; ++i) { expected += i % 3 ? i : 0; }
+    long total = 0;
+    for (auto [key, val]: rd) {
+        EXPECT_EQ(key, val);
+        total += val;
+    }
+    EXPECT_EQ(total, expected);
+    EXPECT_EQ(rd.end() - rd.begin(), static_cast<std::ptrdiff_t>(rd.size()));
+    EXPECT_EQ(std::accumulate(rd.cbegin(), rd.cend(), 0L, [](long sum, auto kv) { return sum + kv.second; }), expected);
+    EXPECT_EQ(rd.begin()[5].first, (rd.begin() + 5)->first);
+
+    for (auto it = rd.begin(); it != rd.end(); ++it) { it->second *= 2; }  // values are writable in place
+    rd.for_each([](const int& key, long& val) { val -= key; });
+    const auto& crd = rd;
+    total = 0;
+    crd.for_each([&](const int& key, const long& val) {
+        EXPECT_EQ(key, val);
+        total += val;
+    });
+    EXPECT_EQ(total, expected);
+
+    std::atomic<long> parallel_total{0};
+    rd.parallel_for_each([&](const int&, long& val) {
+        val += 1;
+        parallel_total.fetch_add(val, std::memory_order_relaxed);
+    }, 4);
+    EXPECT_EQ(parallel_total.load(), expected + static_cast<long>(rd.size()));
+    EXPECT_EQ(rd.at(1), 2);
+
+    std::atomic<int> visited{0};
+    EXPECT_THROW(crd.parallel_for_each([&](const int& key, const long&) {
+        visited.fetch_add(1, std::memory_order_relaxed);
+        if (key == 2) { throw std::runtime_error("stop"); }
+    }, 4), std::runtime_error);
+    EXPECT_GE(visited.load(), 1);
+
+    RandomDict<int, long> empty{1};
+    EXPECT_EQ(empty.begin(), empty.end());
+    empty.parallel_for_each([](const int&, long&) { FAIL(); });
+}
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "randomengine.h"
+#include "randomdict.h"
+using namespace data_structures;
+
+TEST(engine_test, test_reference_streams) {
+    SplitMix64 sm{0};
+    EXPECT_EQ(sm(), 0xe220a8397b1dcdafULL);
+    EXPECT_EQ(sm(), 0x6e789e6aa1b965f4ULL);
+    EXPECT_EQ(sm(), 0x06c45d188009454fULL);
+    Xoshiro256PlusPlus xo{42};
+    EXPECT_EQ(xo(), 0xd0764d4f4476689fULL);
+    EXPECT_EQ(xo(), 0x519e4174576f3791ULL);
+    EXPECT_EQ(xo(), 0xfbe07cfb0c24ed8cULL);
+    Xoshiro256PlusPlus copy = xo;
+    EXPECT_EQ(copy, xo);
+    EXPECT_EQ(copy(), xo());
+}
+
+TEST(engine_test, test_bounded) {
+    uint64_t lo;
+    EXPECT_EQ(detail::mul_wide(~0ULL, ~0ULL, lo), ~0ULL - 1);
+    EXPECT_EQ(lo, 1ULL);
+    Xoshiro256PlusPlus xo{7};
+    std::mt19937 mt{7};
+    EXPECT_EQ(detail::bounded(xo, 1), 0);
+    const uint64_t n = 10;
+    std::vector<int> hist(n, 0), mt_hist(n, 0);
+    const int draws = 100000;
+    for (int i = 0; i < draws; ++i) {
+        uint64_t x = detail::bounded(xo, n), y = detail::bounded(mt, n);
+        ASSERT_LT(x, n);
+        ASSERT_LT(y, n);
+        hist[x]++;
+        mt_hist[y]++;
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        EXPECT_NEAR(hist[i], draws / n, draws / n / 10);
+        EXPECT_NEAR(mt_hist[i], draws / n, draws / n / 10);
+    }
+    // the largest bound still needs the rejection step to stay in range
+    for (int i = 0; i < 100; ++i) {
+        EXPECT_LT(detail::bounded(xo, (1ULL << 63U) + 1), (1ULL << 63U) + 1);
+        const double u = detail::unit_real(xo);
+        EXPECT_GE(u, 0.0);
+        EXPECT_LT(u, 1.0);
+    }
+}
+
+TEST(engine_test, test_pluggable) {
+    RandomSet<int, std::hash<int>, std::equal_to<int>, Xoshiro256PlusPlus> rs{1ULL << 40U};
+    FlatRandomDict<int, int, std::hash<int>, std::equal_to<int>, SplitMix64> frd{99};
+    for (int i = 0; i < 100; ++i) {
+        rs.insert(i);
+        frd[i] = -i;
+    }
+    auto rs_copy = rs;
+    auto frd_copy = frd;
+    for (int i = 0; i < 100; ++i) {  // same engine state, same choices
+        EXPECT_EQ(rs.random_elem(), rs_copy.random_elem());
+        EXPECT_EQ(frd.random_pair(), frd_copy.random_pair());
+    }
+    std::vector<int> picked;
+    rs.sample_distinct(100, std::back_inserter(picked));
+    std::sort(picked.begin(), picked.end());
+    for (int i = 0; i < 100; ++i) { EXPECT_EQ(picked[i], i); }
+}
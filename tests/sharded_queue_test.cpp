@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+#include "shardedqueue.h"
+
+#include <vector>
+#include <thread>
+#include <string>
+#include <atomic>
+
+using namespace data_structures;
+
+TEST(sq_test, test_simple) {
+    ShardedQueue<int> q{4};
+    EXPECT_EQ(q.num_shards(), 4);
+    for (int i = 0; i < 100; ++i) {
+        q.push(100 - i, i);
+    }
+    EXPECT_EQ(q.size(), 100);
+    EXPECT_TRUE(q.contains(42));
+    EXPECT_TRUE(q.remove(42));
+    EXPECT_FALSE(q.contains(42));
+    EXPECT_FALSE(q.remove(42));
+    EXPECT_FALSE(q.reschedule(42, 0));
+    EXPECT_TRUE(q.reschedule(0, -1));
+    std::vector<std::pair<double, int>> due;
+    EXPECT_EQ(q.pop_until(10, std::back_inserter(due)), 11);
+    ASSERT_EQ(due.size(), 11);
+    EXPECT_EQ(due[0], std::make_pair(-1.0, 0));
+    for (std::size_t i = 1; i < due.size(); ++i) {  // merged across shards in order
+        EXPECT_EQ(due[i], std::make_pair(static_cast<double>(i), 100 - static_cast<int>(i)));
+    }
+    EXPECT_EQ(q.size(), 88);
+
+    ShardedQueue<std::pair<int, std::string>, int> named{2, [](const std::pair<int, std::string>& p) { return p.first; }};
+    named.push(2.0, 1, "b");
+    named.push(1.0, 2, "a");
+    std::string order;
+    named.pop_until(5, [&](double, std::pair<int, std::string>&& p) { order += p.second; });
+    EXPECT_EQ(order, "ab");
+}
+
+TEST(sq_test, test_concurrent) {
+    constexpr int num_threads = 4;
+    constexpr int per_thread = 2000;
+    ShardedQueue<int> q{8};
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&q, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                const int id = t * per_thread + i;
+                q.push(id, id);
+                if (i % 2 && i % 5) { q.reschedule(id, -id); }  // ids about to be removed stay out of the poller's reach
+                if (i % 5 == 0) { q.remove(id); }
+            }
+        });
+    }
+    std::size_t drained = 0;
+    std::thread poller([&] {  // drains concurrently with the writers
+        for (int round = 0; round < 100; ++round) {
+            drained += q.pop_until(-1000, [](double, int&&) {});
+        }
+    });
+    for (auto& worker: workers) { worker.join(); }
+    poller.join();
+    std::vector<std::pair<double, int>> rest;
+    drained += q.pop_until(num_threads * per_thread, std::back_inserter(rest));
+    EXPECT_TRUE(std::is_sorted(rest.begin(), rest.end()));
+    EXPECT_EQ(drained, num_threads * per_thread * 4 / 5);
+    EXPECT_EQ(q.size(), 0);
+}
+
+TEST(sq_test, test_cancel_race) {  // cancels of due entries race a drain: each entry goes one way or the other
+    constexpr int num_threads = 4;
+    constexpr int per_thread = 5000;
+    constexpr int n = num_threads * per_thread;
+    ShardedQueue<int> q{8};
+    for (int id = 0; id < n; ++id) { q.push(id % 100, id); }
+    std::vector<std::atomic<int>> outcomes(n);  // 1 once cancelled, 2 once popped
+    std::atomic<bool> go{false};
+    std::vector<std::thread> cancellers;
+    for (int t = 0; t < num_threads; ++t) {
+        cancellers.emplace_back([&, t] {
+            while (!go) { std::this_thread::yield(); }
+            for (int i = 0; i < per_thread; ++i) {
+                const int id = i * num_threads + t;
+                if (q.remove(id)) { outcomes[id] += 1; }
+                EXPECT_FALSE(q.reschedule(id, 0));  // cancelled or popped by now, either way no longer queued
+            }
+        });
+    }
+    std::thread poller([&] {
+        go = true;
+        while (q.size()) {
+            q.pop_until(100, [&](double, int&& id) { outcomes[id] += 2; });
+        }
+    });
+    for (auto& canceller: cancellers) { canceller.join(); }
+    poller.join();
+    for (const auto& outcome: outcomes) { ASSERT_TRUE(outcome == 1 || outcome == 2); }
+    EXPECT_EQ(q.size(), 0);
+}